@@ -0,0 +1,136 @@
+/**
+ * @file: allocation.cpp
+ * Implements allocation.hpp
+ */
+
+#include "allocation.hpp"
+
+#include <cstdlib>
+#include <iomanip>
+
+using namespace std;
+
+namespace mlogo {
+
+namespace allocation {
+
+namespace {
+
+void reportOnExit() { Accounting::instance().report(cerr); }
+
+}  // namespace
+
+Accounting::Accounting() {
+    auto env = getenv("MLOGO_MEMSTATS");
+    if (env && *env) atexit(reportOnExit);
+}
+
+void Accounting::allocate(Subsystem s, size_t bytes) {
+    auto &c = _counters[static_cast<size_t>(s)];
+    c.liveBytes.fetch_add(bytes, memory_order_relaxed);
+    c.liveBlocks.fetch_add(1, memory_order_relaxed);
+    c.totalBlocks.fetch_add(1, memory_order_relaxed);
+
+    auto live = _liveBlocks.fetch_add(1, memory_order_relaxed) + 1;
+    auto peak = _peakBlocks.load(memory_order_relaxed);
+    while (live > peak &&
+           !_peakBlocks.compare_exchange_weak(peak, live,
+                                              memory_order_relaxed)) {
+    }
+}
+
+void Accounting::deallocate(Subsystem s, size_t bytes) {
+    auto &c = _counters[static_cast<size_t>(s)];
+    c.liveBytes.fetch_sub(bytes, memory_order_relaxed);
+    c.liveBlocks.fetch_sub(1, memory_order_relaxed);
+    _liveBlocks.fetch_sub(1, memory_order_relaxed);
+}
+
+void *Accounting::allocateBlock(Subsystem s, size_t bytes) {
+    auto p = ::operator new(bytes);
+    allocate(s, bytes);
+    return p;
+}
+
+void Accounting::deallocateBlock(Subsystem s, void *p, size_t bytes) noexcept {
+    deallocate(s, bytes);
+    ::operator delete(p);
+}
+
+Usage Accounting::usage(Subsystem s) const {
+    auto &c = _counters[static_cast<size_t>(s)];
+
+    Usage u;
+    u.liveBytes = c.liveBytes.load(memory_order_relaxed);
+    u.liveBlocks = c.liveBlocks.load(memory_order_relaxed);
+    u.totalBlocks = c.totalBlocks.load(memory_order_relaxed);
+
+    return u;
+}
+
+Usage Accounting::total() const {
+    Usage t;
+    for (size_t i = 0; i < SUBSYSTEMS; ++i) {
+        auto u = usage(static_cast<Subsystem>(i));
+        t.liveBytes += u.liveBytes;
+        t.liveBlocks += u.liveBlocks;
+        t.totalBlocks += u.totalBlocks;
+    }
+
+    return t;
+}
+
+pair<uint64_t, uint64_t> Accounting::nodes() {
+    auto live = _liveBlocks.load(memory_order_relaxed);
+    auto peak = _peakBlocks.exchange(live, memory_order_relaxed);
+
+    return make_pair(live, peak);
+}
+
+ostream &Accounting::report(ostream &s) const {
+    auto flags = s.flags();
+
+    s << setw(14) << left << "subsystem" << setw(14) << right << "live bytes"
+      << setw(14) << "live blocks" << setw(16) << "total blocks" << endl;
+
+    auto line = [&s](const char *name, const Usage &u) {
+        s << setw(14) << left << name << setw(14) << right << u.liveBytes
+          << setw(14) << u.liveBlocks << setw(16) << u.totalBlocks << endl;
+    };
+
+    for (size_t i = 0; i < SUBSYSTEMS; ++i) {
+        auto subsystem = static_cast<Subsystem>(i);
+        line(name(subsystem), usage(subsystem));
+    }
+    line("total", total());
+
+    s.flags(flags);
+    return s;
+}
+
+const char *Accounting::name(Subsystem s) {
+    switch (s) {
+    case Subsystem::AST:
+        return "ast";
+    case Subsystem::PARSE_TREE:
+        return "parse tree";
+    case Subsystem::FRAMES:
+        return "frames";
+    case Subsystem::VALUES:
+        return "values";
+    case Subsystem::TURTLE_PATHS:
+        return "turtle paths";
+    case Subsystem::TURTLES:
+        return "turtles";
+    case Subsystem::GRAPHICS:
+        return "graphics";
+    case Subsystem::SUBSYSTEMS:
+        break;
+    }
+
+    return "unknown";
+}
+
+} /* ns: allocation */
+
+} /* ns: mlogo */
@@ -0,0 +1,178 @@
+/**
+ * @file: allocation.hpp
+ *
+ * Memory accounting of interpreter data structures.
+ *
+ * Containers use Allocator<T, S> and heap allocated nodes derive from
+ * Accounted<S>, so live bytes and allocations are charged to subsystem S.
+ * Usage is exposed by NODES and .NODES, and printed on exit when
+ * MLOGO_MEMSTATS is set.
+ */
+
+#ifndef __ALLOCATION_HPP__
+#define __ALLOCATION_HPP__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace mlogo {
+
+namespace allocation {
+
+enum class Subsystem {
+    AST,           //!< AST nodes and statement lists
+    PARSE_TREE,    //!< parser statements and expressions
+    FRAMES,        //!< memory frames, variables and procedures tables
+    VALUES,        //!< ValueBox list payloads
+    TURTLE_PATHS,  //!< turtle history
+    TURTLES,       //!< state of every turtle
+    GRAPHICS,      //!< buffers owned by graphics backends
+    SUBSYSTEMS     //!< number of subsystems, not a subsystem
+};
+
+struct Usage {
+    uint64_t liveBytes{0};
+    uint64_t liveBlocks{0};
+    uint64_t totalBlocks{0};
+};
+
+class Accounting {
+public:
+    static constexpr std::size_t SUBSYSTEMS{
+        static_cast<std::size_t>(Subsystem::SUBSYSTEMS)};
+
+    static Accounting &instance() {
+        static Accounting _instance;
+        return _instance;
+    }
+
+    void allocate(Subsystem s, std::size_t bytes);
+    void deallocate(Subsystem s, std::size_t bytes);
+
+    /**
+     * Allocate and charge, or free and credit, a block of Accounted<S>.
+     * They are out of line so that the compiler pairs the class operator
+     * delete with the class operator new, not with ::operator new.
+     */
+    void *allocateBlock(Subsystem s, std::size_t bytes);
+    void deallocateBlock(Subsystem s, void *p, std::size_t bytes) noexcept;
+
+    Usage usage(Subsystem s) const;
+    Usage total() const;
+
+    /// Live blocks now and at most since the previous call (like NODES).
+    std::pair<uint64_t, uint64_t> nodes();
+
+    std::ostream &report(std::ostream &s) const;
+
+    static const char *name(Subsystem s);
+
+private:
+    struct Counters {
+        std::atomic<uint64_t> liveBytes{0};
+        std::atomic<uint64_t> liveBlocks{0};
+        std::atomic<uint64_t> totalBlocks{0};
+    };
+
+    Accounting();
+
+    Accounting(const Accounting &) = delete;
+    Accounting(Accounting &&) = delete;
+
+    Accounting &operator=(const Accounting &) = delete;
+    Accounting &operator=(Accounting &&) = delete;
+
+    std::array<Counters, SUBSYSTEMS> _counters;
+    std::atomic<uint64_t> _liveBlocks{0};
+    std::atomic<uint64_t> _peakBlocks{0};
+};
+
+/// Subsystem as a type, usable where only type parameters are allowed.
+template <Subsystem S>
+struct Tag {
+    static constexpr Subsystem subsystem{S};
+};
+
+/**
+ * Standard allocator charging every allocation to a subsystem.
+ *
+ * The subsystem is passed as a Tag type, so the allocator can be used
+ * inside boost::make_recursive_variant (see types::ListValue).
+ */
+template <typename T, typename Tag>
+struct BasicAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = BasicAllocator<U, Tag>;
+    };
+
+    BasicAllocator() noexcept {}
+
+    template <typename U>
+    BasicAllocator(const BasicAllocator<U, Tag> &) noexcept {}
+
+    T *allocate(std::size_t n) {
+        auto p = static_cast<T *>(::operator new(n * sizeof(T)));
+        Accounting::instance().allocate(Tag::subsystem, n * sizeof(T));
+        return p;
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept {
+        Accounting::instance().deallocate(Tag::subsystem, n * sizeof(T));
+        ::operator delete(p);
+    }
+};
+
+template <typename T, typename U, typename Tag>
+bool operator==(const BasicAllocator<T, Tag> &,
+                const BasicAllocator<U, Tag> &) {
+    return true;
+}
+
+template <typename T, typename U, typename Tag>
+bool operator!=(const BasicAllocator<T, Tag> &,
+                const BasicAllocator<U, Tag> &) {
+    return false;
+}
+
+template <typename T, Subsystem S>
+using Allocator = BasicAllocator<T, Tag<S>>;
+
+/// A std::vector whose buffer is charged to S.
+template <typename T, Subsystem S>
+using Vector = std::vector<T, Allocator<T, S>>;
+
+/**
+ * Base class for objects allocated with new: charge them to S.
+ */
+template <Subsystem S>
+struct Accounted {
+    static void *operator new(std::size_t size) {
+        return Accounting::instance().allocateBlock(S, size);
+    }
+
+    static void operator delete(void *p, std::size_t size) noexcept {
+        Accounting::instance().deallocateBlock(S, p, size);
+    }
+
+    // placement new is hidden by the class operator new otherwise
+    static void *operator new(std::size_t, void *where) noexcept {
+        return where;
+    }
+
+    static void operator delete(void *, void *) noexcept {}
+};
+
+} /* ns: allocation */
+
+} /* ns: mlogo */
+
+#endif /* __ALLOCATION_HPP__ */
@@ -7,6 +7,7 @@
 
 #include "../geometry.hpp"
 #include "../memory.hpp"
+#include "../stats.hpp"
 #include "common.hpp"
 
 using namespace mlogo::geometry;
@@ -41,6 +42,7 @@ struct ArithmeticOperation : BuiltinProcedure {
         else
             ss << result;
 
+        stats::count(stats::Counter::CONVERSIONS);
         setReturnValue(ss.str());
     }
 
@@ -61,6 +63,7 @@ struct ArithmeticUnary : BuiltinProcedure {
         else
             ss << result;
 
+        stats::count(stats::Counter::CONVERSIONS);
         setReturnValue(ss.str());
     }
 
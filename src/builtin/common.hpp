@@ -35,12 +35,19 @@ using Turtle = turtle::Turtle;
 
 using types::toString;
 
+/// Local variables of instructions run by a builtin live in a new frame.
+struct NewFrameRAII {
+    NewFrameRAII() { Stack::instance().openFrame(); }
+    ~NewFrameRAII() { Stack::instance().closeFrame(); }
+};
+
 void initArithmeticBuiltInProcedures();
 void initDataBuiltInProcedures();
 void initCommBuiltInProcedures();
 void initMemoryBuiltInProcedures();
 void initControlBuiltInProcedures();
 void initGraphicsBuiltInProcedures();
+void initDebugBuiltInProcedures();
 
 std::istream &inputStream();
 std::ostream &outputStream();
@@ -18,11 +18,6 @@ namespace builtin {
 
 namespace {
 
-struct NewFrameRAII {
-    NewFrameRAII() { Stack::instance().openFrame(); }
-    ~NewFrameRAII() { Stack::instance().closeFrame(); }
-};
-
 struct Run : BuiltinProcedure {
     Run() : BuiltinProcedure(1) {}
     void operator()() const override {
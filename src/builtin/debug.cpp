@@ -0,0 +1,113 @@
+/**
+ * @file: debug.cpp
+ *
+ * Builtins used to inspect the interpreter itself.
+ */
+
+#include "common.hpp"
+
+#include "../allocation.hpp"
+#include "../graphics.hpp"
+#include "../perf.hpp"
+#include "../profiler.hpp"
+#include "../stats.hpp"
+#include "../trace.hpp"
+
+namespace mlogo {
+
+namespace builtin {
+
+namespace {
+
+struct TraceFlush : BuiltinProcedure {
+    TraceFlush() : BuiltinProcedure(0) {}
+    void operator()() const override { trace::Tracer::instance().flush(); }
+};
+
+struct ProfileStart : BuiltinProcedure {
+    ProfileStart() : BuiltinProcedure(1) {}
+    void operator()() const override {
+        auto filename = fetchArg(0).toString();
+        profiler::Sampler::instance().start(filename);
+    }
+};
+
+struct ProfileStop : BuiltinProcedure {
+    ProfileStop() : BuiltinProcedure(0) {}
+    void operator()() const override { profiler::Sampler::instance().stop(); }
+};
+
+struct Stats : BuiltinProcedure {
+    Stats() : BuiltinProcedure(0) {}
+    void operator()() const override {
+        // segments and presents are counted by the window, maybe behind
+        graphics::Context::instance().sync();
+        stats::Stats::instance().report(outputStream());
+    }
+};
+
+struct StatsReset : BuiltinProcedure {
+    StatsReset() : BuiltinProcedure(0) {}
+    void operator()() const override { stats::Stats::instance().reset(); }
+};
+
+struct PerfStart : BuiltinProcedure {
+    PerfStart() : BuiltinProcedure(0) {}
+    void operator()() const override { perf::Counters::instance().start(); }
+};
+
+struct PerfStop : BuiltinProcedure {
+    PerfStop() : BuiltinProcedure(0) {}
+    void operator()() const override { perf::Counters::instance().stop(); }
+};
+
+struct PerfReport : BuiltinProcedure {
+    PerfReport() : BuiltinProcedure(0) {}
+    void operator()() const override {
+        perf::Counters::instance().report(outputStream());
+    }
+};
+
+/// UCB NODES: [live peak] allocated blocks, peak since the previous call.
+struct Nodes : BuiltinProcedure {
+    Nodes() : BuiltinProcedure(0, true) {}
+    void operator()() const override {
+        auto nodes = allocation::Accounting::instance().nodes();
+
+        ListValue out;
+        out.push_back(std::to_string(nodes.first));
+        out.push_back(std::to_string(nodes.second));
+
+        setReturnValue(out);
+    }
+};
+
+struct NodesReport : BuiltinProcedure {
+    NodesReport() : BuiltinProcedure(0) {}
+    void operator()() const override {
+        allocation::Accounting::instance().report(outputStream());
+    }
+};
+
+}  // namespace
+
+/**
+ * Register procedures in memory
+ */
+void initDebugBuiltInProcedures() {
+    Stack::instance()
+        .setProcedure<TraceFlush>("trace.flush")
+        .setProcedure<ProfileStart>("profile.start")
+        .setProcedure<ProfileStop>("profile.stop")
+        .setProcedure<Stats>(".stats")
+        .setProcedure<StatsReset>(".stats.reset")
+        .setProcedure<PerfStart>("perf.start")
+        .setProcedure<PerfStop>("perf.stop")
+        .setProcedure<PerfReport>("perf.report")
+        .setProcedure<Nodes>("nodes")
+        .setProcedure<NodesReport>(".nodes");
+}
+
+}  // namespace builtin
+
+}  // namespace mlogo
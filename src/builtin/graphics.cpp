@@ -7,11 +7,38 @@
 
 #include "common.hpp"
 
+#include <algorithm>
+
+#include "../interpreter.hpp"
+
 namespace mlogo {
 namespace builtin {
 
 namespace {
 
+/// A turtle number, or a list of them: repeated numbers are kept once,
+/// or the turtle would turn once per repetition but move only once.
+Turtle::Numbers toTurtles(ValueBox arg) {
+    Turtle::Numbers out;
+    auto push = [&out](const ValueBox &n) {
+        auto number = n.asUnsigned();
+        if (number >= Turtle::MAX_TURTLES)
+            throw std::logic_error("Turtle number out of range");
+        if (std::find(out.begin(), out.end(), number) == out.end())
+            out.push_back(number);
+    };
+
+    if (arg.isWord()) {
+        push(arg);
+        return out;
+    }
+
+    for (const auto &n : arg.list()) push(ValueBox(n));
+    if (out.empty()) throw std::logic_error("Expected turtle numbers");
+
+    return out;
+}
+
 /**
  * Turtle Graphics
  */
@@ -47,6 +74,40 @@ struct Left : BuiltinProcedure {
     }
 };
 
+struct Arc : BuiltinProcedure {
+    Arc() : BuiltinProcedure(2) {}
+    void operator()() const override {
+        Turtle::instance().arc(fetchArg(0).asDouble(), fetchArg(1).asDouble());
+    }
+};
+
+struct Circle : BuiltinProcedure {
+    Circle() : BuiltinProcedure(1) {}
+    void operator()() const override {
+        Turtle::instance().circle(fetchArg(0).asDouble());
+    }
+};
+
+struct Ellipse : BuiltinProcedure {
+    Ellipse() : BuiltinProcedure(2) {}
+    void operator()() const override {
+        Turtle::instance().ellipse(fetchArg(0).asDouble(),
+                                   fetchArg(1).asDouble());
+    }
+};
+
+struct Poly : BuiltinProcedure {
+    Poly() : BuiltinProcedure(2) {}
+    void operator()() const override {
+        double sides = fetchArg(0).asDouble();
+        if (!(sides >= 3 && sides <= Turtle::MAX_POLYGON_SIDES) ||
+            sides != std::floor(sides))
+            throw std::logic_error("Polygon sides out of range");
+
+        Turtle::instance().polygon(sides, fetchArg(1).asDouble());
+    }
+};
+
 struct Home : BuiltinProcedure {
     Home() : BuiltinProcedure(0) {}
     void operator()() const override { Turtle::instance().home(); }
@@ -263,6 +324,202 @@ struct Towards : BuiltinProcedure {
         setReturnValue(ss.str());
     }
 };
+
+struct Refresh : BuiltinProcedure {
+    Refresh() : BuiltinProcedure(0) {}
+    void operator()() const override { Turtle::instance().refresh(true); }
+};
+
+struct NoRefresh : BuiltinProcedure {
+    NoRefresh() : BuiltinProcedure(0) {}
+    void operator()() const override { Turtle::instance().refresh(false); }
+};
+
+struct UpdateGraph : BuiltinProcedure {
+    UpdateGraph() : BuiltinProcedure(0) {}
+    void operator()() const override { Turtle::instance().update(); }
+};
+
+struct SetFps : BuiltinProcedure {
+    SetFps() : BuiltinProcedure(1) {}
+    void operator()() const override {
+        Turtle::instance().frameRate(fetchArg(0).asUnsigned());
+    }
+};
+
+struct Fps : BuiltinProcedure {
+    Fps() : BuiltinProcedure(0, true) {}
+    void operator()() const override {
+        setReturnValue(std::size_t(Turtle::instance().frameRate()));
+    }
+};
+
+struct Fill : BuiltinProcedure {
+    Fill() : BuiltinProcedure(0) {}
+    void operator()() const override { Turtle::instance().fill(); }
+};
+
+struct Filled : BuiltinProcedure {
+    Filled() : BuiltinProcedure(2) {}
+    void operator()() const override {
+        auto color = fetchArg(0).list();
+        if (color.size() != 3) throw std::logic_error("Expected R,G,B Color");
+        uint8_t rgb[3];
+        for (size_t i = 0; i < 3; ++i) {
+            auto c = ValueBox(color[i]).asUnsigned();
+            if (c > 255) throw std::logic_error("Color out of range");
+            rgb[i] = c;
+        }
+        string instructions = fetchArg(1).toString();
+
+        auto &turtle = Turtle::instance();
+        turtle.beginFill();
+        try {
+            NewFrameRAII frameGuard;
+            auto interpreter =
+                getInterpreter(inputStream(), outputStream(), errorStream());
+            interpreter.one(instructions);
+        } catch (exceptions::StopException &e) {
+        } catch (...) {
+            turtle.endFill(rgb[0], rgb[1], rgb[2]);
+            throw;
+        }
+        turtle.endFill(rgb[0], rgb[1], rgb[2]);
+    }
+};
+
+struct Tell : BuiltinProcedure {
+    Tell() : BuiltinProcedure(1) {}
+    void operator()() const override {
+        Turtle::instance().select(toTurtles(fetchArg(0)));
+    }
+};
+
+struct Ask : BuiltinProcedure {
+    Ask() : BuiltinProcedure(2) {}
+    void operator()() const override {
+        auto turtles = toTurtles(fetchArg(0));
+        string instructions = fetchArg(1).toString();
+
+        auto &turtle = Turtle::instance();
+        auto previous = turtle.selected();
+        turtle.select(turtles);
+        try {
+            NewFrameRAII frameGuard;
+            auto interpreter =
+                getInterpreter(inputStream(), outputStream(), errorStream());
+            interpreter.one(instructions);
+        } catch (exceptions::StopException &e) {
+        } catch (...) {
+            turtle.select(previous);
+            throw;
+        }
+        turtle.select(previous);
+    }
+};
+
+struct Who : BuiltinProcedure {
+    Who() : BuiltinProcedure(0, true) {}
+    void operator()() const override {
+        auto selected = Turtle::instance().selected();
+        if (selected.size() == 1) {
+            setReturnValue(selected.front());
+            return;
+        }
+
+        ListValue out;
+        for (auto n : selected) out.push_back(std::to_string(n));
+        setReturnValue(out);
+    }
+};
+
+struct Turtles : BuiltinProcedure {
+    Turtles() : BuiltinProcedure(0, true) {}
+    void operator()() const override {
+        ListValue out;
+        for (size_t n = 0; n < Turtle::instance().turtles(); ++n)
+            out.push_back(std::to_string(n));
+        setReturnValue(out);
+    }
+};
+
+struct Zoom : BuiltinProcedure {
+    Zoom() : BuiltinProcedure(1) {}
+    void operator()() const override {
+        double zoom = fetchArg(0).asDouble();
+        if (!(zoom > 0)) throw std::logic_error("Zoom must be positive");
+
+        auto &turtle = Turtle::instance();
+        auto view = turtle.viewport();
+        turtle.viewport(std::get<0>(view), std::get<1>(view), zoom);
+    }
+};
+
+struct SetViewport : BuiltinProcedure {
+    SetViewport() : BuiltinProcedure(1) {}
+    void operator()() const override {
+        auto center = fetchArg(0).list();
+        if (center.size() != 2)
+            throw std::logic_error("Expected X,Y Coordinates");
+        double x = ValueBox(center[0]).asDouble();
+        double y = ValueBox(center[1]).asDouble();
+
+        auto &turtle = Turtle::instance();
+        turtle.viewport(x, y, std::get<2>(turtle.viewport()));
+    }
+};
+
+struct Viewport : BuiltinProcedure {
+    Viewport() : BuiltinProcedure(0, true) {}
+    void operator()() const override {
+        auto view = Turtle::instance().viewport();
+        ListValue out;
+        for (auto v : {std::get<0>(view), std::get<1>(view),
+                       std::get<2>(view)}) {
+            stringstream ss;
+            ss << v;
+            out.push_back(ss.str());
+        }
+
+        setReturnValue(out);
+    }
+};
+
+struct SetHistory : BuiltinProcedure {
+    SetHistory() : BuiltinProcedure(1) {}
+    void operator()() const override {
+        Turtle::instance().historyLimit(fetchArg(0).asUnsigned());
+    }
+};
+
+struct History : BuiltinProcedure {
+    History() : BuiltinProcedure(0, true) {}
+    void operator()() const override {
+        setReturnValue(Turtle::instance().historyLimit());
+    }
+};
+
+struct SavePict : BuiltinProcedure {
+    SavePict() : BuiltinProcedure(1) {}
+    void operator()() const override {
+        Turtle::instance().savePicture(fetchArg(0).toString());
+    }
+};
+
+struct SetPictLevel : BuiltinProcedure {
+    SetPictLevel() : BuiltinProcedure(1) {}
+    void operator()() const override {
+        Turtle::instance().pictureLevel(png::level(fetchArg(0).toString()));
+    }
+};
+
+struct PictLevel : BuiltinProcedure {
+    PictLevel() : BuiltinProcedure(0, true) {}
+    void operator()() const override {
+        auto level = Turtle::instance().pictureLevel();
+        setReturnValue(string(png::name(level)));
+    }
+};
 }
 
 /**
@@ -279,6 +536,19 @@ void initGraphicsBuiltInProcedures() {
         .setProcedure<Right>("rt")
         .setProcedure<Left>("left")
         .setProcedure<Left>("lt")
+        .setProcedure<Arc>("arc")
+        .setProcedure<Circle>("circle")
+        .setProcedure<Ellipse>("ellipse")
+        .setProcedure<Poly>("poly")
+        .setProcedure<Fill>("fill")
+        .setProcedure<Filled>("filled")
+        .setProcedure<Tell>("tell")
+        .setProcedure<Ask>("ask")
+        .setProcedure<Who>("who")
+        .setProcedure<Turtles>("turtles")
+        .setProcedure<Zoom>("zoom")
+        .setProcedure<SetViewport>("setviewport")
+        .setProcedure<Viewport>("viewport")
         .setProcedure<Home>("home")
         .setProcedure<Clean>("clean")
         .setProcedure<ClearScreen>("clearscreen")
@@ -309,7 +579,17 @@ void initGraphicsBuiltInProcedures() {
         .setProcedure<PenUp>("pu")
         .setProcedure<PenDown>("pendown")
         .setProcedure<PenDown>("pd")
-        .setProcedure<Towards>("towards");
+        .setProcedure<Towards>("towards")
+        .setProcedure<Refresh>("refresh")
+        .setProcedure<NoRefresh>("norefresh")
+        .setProcedure<UpdateGraph>("updategraph")
+        .setProcedure<SetFps>("setfps")
+        .setProcedure<Fps>("fps")
+        .setProcedure<SetHistory>("sethistory")
+        .setProcedure<History>("history")
+        .setProcedure<SavePict>("savepict")
+        .setProcedure<SetPictLevel>("setpictlevel")
+        .setProcedure<PictLevel>("pictlevel");
 }
 }
 }
@@ -19,6 +19,7 @@ extern "C" void initBuiltInProcedures() {
     mlogo::builtin::initMemoryBuiltInProcedures();
     mlogo::builtin::initControlBuiltInProcedures();
     mlogo::builtin::initGraphicsBuiltInProcedures();
+    mlogo::builtin::initDebugBuiltInProcedures();
 }
 
 extern "C" void connectStreams(std::istream *is, std::ostream *os,
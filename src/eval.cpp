@@ -15,6 +15,9 @@
 
 #include "exceptions.hpp"
 #include "memory.hpp"
+#include "perf.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 
 #include "eval_impl.hpp"
 
@@ -27,6 +30,9 @@ namespace eval {
 using Stack = memory::Stack;
 using ASTNodeAlreadyConnected = exceptions::ASTNodeAlreadyConnected;
 
+/// Trace event name for make_ast()
+static const string MAKE_AST_TRACE_NAME{"make_ast"};
+
 ASTNode make_statement(const mlogo::parser::Statement &stmt) {
     ASTNode s{new ASTNode::Procedure(stmt.name.name)};
     impl::EvalStmtBuilderVisitor v(&s);
@@ -39,6 +45,9 @@ ASTNode make_statement(const mlogo::parser::Statement &stmt) {
 }
 
 AST make_ast(const mlogo::parser::Statement &stmt) {
+    trace::Scope traceScope("eval", MAKE_AST_TRACE_NAME);
+    perf::PhaseScope phase(perf::Phase::COMPILE);
+
     AST ast;
     mlogo::parser::Argument proc{stmt.name};
     impl::EvalStmtBuilderVisitor v(&ast);
@@ -75,6 +84,8 @@ ValueBox ASTNode::Variable::value(const ASTNode *) const {
 }
 
 ASTNode::ASTNode(Type *t, ASTNode *parent) : type(t), _parent(parent) {
+    stats::count(stats::Counter::AST_NODES);
+
     if (_parent) {
         _parent->children.push_back(this);
     }
@@ -132,6 +143,8 @@ AST &AST::operator=(AST &&ast) {
 }
 
 void AST::apply(bool catchStop) const {
+    perf::PhaseScope phase(perf::Phase::EVAL);
+
     try {
         for (auto s : statements) {
             auto v = s->apply();
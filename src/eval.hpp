@@ -13,6 +13,7 @@
 #include <string>
 #include <vector>
 
+#include "allocation.hpp"
 #include "defines.hpp"
 
 namespace mlogo {
@@ -27,9 +28,9 @@ namespace eval {
 
 using ValueBox = types::ValueBox;
 
-class ASTNode {
+class ASTNode : public allocation::Accounted<allocation::Subsystem::AST> {
 public:
-    struct Type {
+    struct Type : allocation::Accounted<allocation::Subsystem::AST> {
         virtual ~Type(){};
 
         virtual ValueBox value(const ASTNode*) const = 0;
@@ -93,7 +94,7 @@ private:
 
     Type* type;
     ASTNode* _parent{nullptr};
-    std::vector<ASTNode*> children;
+    allocation::Vector<ASTNode*, allocation::Subsystem::AST> children;
 
     friend struct ASTNode::Procedure;
     FRIEND_TEST(Eval, moveASTNode);
@@ -122,7 +123,7 @@ private:
     AST(const AST&) = delete;
     AST& operator=(const AST&) = delete;
 
-    std::vector<ASTNode*> statements;
+    allocation::Vector<ASTNode*, allocation::Subsystem::AST> statements;
 
     friend AST make_ast(const mlogo::parser::Statement& stmt);
     FRIEND_TEST(Eval, moveAST);
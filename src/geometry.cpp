@@ -4,6 +4,12 @@
 
 #include "geometry.hpp"
 
+#include <algorithm>
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+
 #include "exceptions.hpp"
 
 using namespace std;
@@ -22,12 +28,34 @@ constexpr double MAX_DEG{360};
 constexpr double ROUND_PRECISION{1e6};
 
 double degNormalize(double r) {
-    while (r < 0) r += MAX_DEG;
-    while (r >= MAX_DEG) r -= MAX_DEG;
+    r = fmod(r, MAX_DEG);
+    if (r < 0) r += MAX_DEG;
+    if (r >= MAX_DEG) r -= MAX_DEG;  // a tiny negative r rounds up to 360
 
     return r;
 }
 
+/// sin of k * 15 degrees, exact as far as a double goes.
+constexpr double SIN15[] = {
+    0.0,                  0.25881904510252074,  0.5,
+    0.70710678118654752,  0.86602540378443865,  0.96592582628906829,
+    1.0,                  0.96592582628906829,  0.86602540378443865,
+    0.70710678118654752,  0.5,                  0.25881904510252074,
+    0.0,                  -0.25881904510252074, -0.5,
+    -0.70710678118654752, -0.86602540378443865, -0.96592582628906829,
+    -1.0,                 -0.96592582628906829, -0.86602540378443865,
+    -0.70710678118654752, -0.5,                 -0.25881904510252074};
+constexpr int STEPS{sizeof(SIN15) / sizeof(SIN15[0])};
+constexpr int QUARTER{STEPS / 4};
+
+/// Index in SIN15 of angle degrees, -1 if it is not a multiple of 15.
+int sin15(double degrees) {
+    double k = degrees / (MAX_DEG / STEPS);
+    if (k != floor(k)) return -1;
+
+    return int(k) % STEPS;
+}
+
 double rad2deg(double d) { return degNormalize(d / RADIANS4DEGREES); }
 
 double myround(double v) {
@@ -98,6 +126,9 @@ Angle &Angle::inv() {
 }
 
 double Angle::sin() const {
+    int k = _inverse ? -1 : sin15(_value);
+    if (k >= 0) return SIN15[k];
+
     double v = std::sin(asRadians());
 
     if (isZero(v)) v = 0.0;
@@ -106,6 +137,9 @@ double Angle::sin() const {
 }
 
 double Angle::cos() const {
+    int k = _inverse ? -1 : sin15(_value);
+    if (k >= 0) return SIN15[(k + QUARTER) % STEPS];
+
     double v = std::cos(asRadians());
 
     if (isZero(v)) v = 0.0;
@@ -122,7 +156,7 @@ double Angle::tan() const {
     return v;
 }
 
-Reference::Reference(double kx, int ox, double ky, int oy)
+Reference::Reference(double kx, double ox, double ky, double oy)
     : kx(kx), ky(ky), ox(ox), oy(oy) {}
 
 Point Reference::toGPS(const Point &p) const {
@@ -133,6 +167,18 @@ Point Reference::fromGPS(const Point &p) const {
     return Point(kx * (p.x - ox), ky * (p.y - oy), *this);
 }
 
+void Reference::toGPS(const float *xs, const float *ys, size_t n,
+                      double *outX, double *outY) const {
+    for (size_t i = 0; i < n; ++i) {
+        outX[i] = double(xs[i]) / kx + ox;
+        outY[i] = double(ys[i]) / ky + oy;
+    }
+}
+
+Affine Reference::toGPS() const {
+    return Affine::translation(ox, oy) * Affine::scale(1 / kx, 1 / ky);
+}
+
 bool Reference::operator==(const Reference &ref) const {
     return ((ref.ox == ox) && (ref.oy == oy) && (ref.kx == kx) &&
             (ref.ky == ky));
@@ -224,6 +270,97 @@ double Point::distance(const Point &p) {
     return sqrt(square(x - p.x) + square(y - p.y));
 }
 
+Affine Affine::identity() { return Affine(); }
+
+Affine Affine::translation(double x, double y) {
+    Affine m;
+    m.tx = x;
+    m.ty = y;
+    return m;
+}
+
+Affine Affine::translation(const Point &p) { return translation(p.x, p.y); }
+
+Affine Affine::rotation(const Angle &a) {
+    double sin_a = sin(a);
+    double cos_a = cos(a);
+
+    Affine m;
+    m.xx = cos_a;
+    m.xy = -sin_a;
+    m.yx = sin_a;
+    m.yy = cos_a;
+    return m;
+}
+
+Affine Affine::scale(double sx, double sy) {
+    Affine m;
+    m.xx = sx;
+    m.yy = sy;
+    return m;
+}
+
+Affine Affine::operator*(const Affine &o) const {
+    Affine m;
+    m.xx = xx * o.xx + xy * o.yx;
+    m.xy = xx * o.xy + xy * o.yy;
+    m.tx = xx * o.tx + xy * o.ty + tx;
+    m.yx = yx * o.xx + yy * o.yx;
+    m.yy = yx * o.xy + yy * o.yy;
+    m.ty = yx * o.tx + yy * o.ty + ty;
+    return m;
+}
+
+Point Affine::apply(const Point &p) const {
+    return Point(xx * p.x + xy * p.y + tx, yx * p.x + yy * p.y + ty,
+                 p.system);
+}
+
+void Affine::apply(const float *xs, const float *ys, size_t n, float *outX,
+                   float *outY) const {
+    size_t i{0};
+
+#if defined(__AVX__)
+    auto a = _mm256_set1_ps(xx), b = _mm256_set1_ps(xy),
+         c = _mm256_set1_ps(tx);
+    auto d = _mm256_set1_ps(yx), e = _mm256_set1_ps(yy),
+         f = _mm256_set1_ps(ty);
+    for (; i + 8 <= n; i += 8) {
+        auto x = _mm256_loadu_ps(xs + i), y = _mm256_loadu_ps(ys + i);
+        _mm256_storeu_ps(
+            outX + i,
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, x),
+                                        _mm256_mul_ps(b, y)),
+                          c));
+        _mm256_storeu_ps(
+            outY + i,
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(d, x),
+                                        _mm256_mul_ps(e, y)),
+                          f));
+    }
+#elif defined(__SSE__)
+    auto a = _mm_set1_ps(xx), b = _mm_set1_ps(xy), c = _mm_set1_ps(tx);
+    auto d = _mm_set1_ps(yx), e = _mm_set1_ps(yy), f = _mm_set1_ps(ty);
+    for (; i + 4 <= n; i += 4) {
+        auto x = _mm_loadu_ps(xs + i), y = _mm_loadu_ps(ys + i);
+        _mm_storeu_ps(outX + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, x),
+                                                      _mm_mul_ps(b, y)),
+                                           c));
+        _mm_storeu_ps(outY + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(d, x),
+                                                      _mm_mul_ps(e, y)),
+                                           f));
+    }
+#endif
+
+    // same float arithmetic as the vector lanes
+    float a1 = xx, b1 = xy, c1 = tx, d1 = yx, e1 = yy, f1 = ty;
+    for (; i < n; ++i) {
+        float x = xs[i], y = ys[i];
+        outX[i] = a1 * x + b1 * y + c1;
+        outY[i] = d1 * x + e1 * y + f1;
+    }
+}
+
 Path::Path(const Reference &system, int x, int y) : system(system) {
     push_back(x, y);
 }
@@ -265,9 +402,13 @@ Path Path::translate(int offsetX, int offsetY) const {
 }
 
 Path Path::rotate(const Angle &a) const {
+    return transform(Affine::rotation(a));
+}
+
+Path Path::transform(const Affine &m) const {
     Path p{*this};
 
-    for (auto &point : p) point = point.rotate(a);
+    for (auto &point : p) point = m.apply(point);
 
     return p;
 }
@@ -288,6 +429,213 @@ bool Path::empty() const {
     return size() < 2;  // at least 2 points are needed by a path
 }
 
+Box::Box(double left, double bottom, double right, double top)
+    : left(left), bottom(bottom), right(right), top(top) {}
+
+bool Box::contains(const Point &p) const {
+    return p.x >= left && p.x <= right && p.y >= bottom && p.y <= top;
+}
+
+bool Box::clip(const Point &a, const Point &b, double &t0, double &t1) const {
+    double dx = b.x - a.x, dy = b.y - a.y;
+    const double p[] = {-dx, dx, -dy, dy};
+    const double q[] = {a.x - left, right - a.x, a.y - bottom, top - a.y};
+
+    t0 = 0;
+    t1 = 1;
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0) {
+            if (q[i] < 0) return false;  // parallel to the side, outside
+            continue;
+        }
+
+        double r = q[i] / p[i];
+        if (p[i] < 0)
+            t0 = max(t0, r);  // entering
+        else
+            t1 = min(t1, r);  // leaving
+    }
+
+    return t0 <= t1;
+}
+
+Box::Exit Box::exit(const Point &p, const Point &d) const {
+    auto along = [](double from, double v, double low, double high) {
+        if (v > 0) return (high - from) / v;
+        if (v < 0) return (low - from) / v;
+        return double(INFINITY);
+    };
+
+    double tx = along(p.x, d.x, left, right);
+    double ty = along(p.y, d.y, bottom, top);
+    double t = min(tx, ty);
+
+    return Exit{t, tx == t && !isinf(t), ty == t && !isinf(t)};
+}
+
+Scene::Scene(const Reference &system) : _system(system) {}
+
+Scene &Scene::moveTo(const Point &p) {
+    _starts.push_back(_x.size());
+    push(p);
+    return *this;
+}
+
+Scene &Scene::lineTo(const Point &p) {
+    if (_starts.empty()) _starts.push_back(_x.size());
+    push(p);
+    return *this;
+}
+
+Scene &Scene::extendTo(const Point &p) {
+    auto n = size();
+    if (_starts.empty() || n - _starts.back() < 2) return lineTo(p);
+
+    auto c = local(p);
+    double ax = _x[n - 2], ay = _y[n - 2];
+    double ux = _x[n - 1] - ax, uy = _y[n - 1] - ay;  // last segment
+    double vx = c.x - ax, vy = c.y - ay;              // prolonged segment
+
+    // the last point must lie on the new segment, before its end
+    bool forward = ux * vx + uy * vy > ux * ux + uy * uy;
+    bool onLine = fabs(ux * vy - uy * vx) <= COLLINEAR * hypot(vx, vy);
+    if (!forward || !onLine) return lineTo(p);
+
+    _x[n - 1] = c.x;
+    _y[n - 1] = c.y;
+    return *this;
+}
+
+void Scene::clear() {
+    _x.clear();
+    _y.clear();
+    _starts.clear();
+}
+
+Point Scene::operator[](size_t i) const {
+    return Point(double(_x[i]), double(_y[i]), _system);
+}
+
+Point Scene::last() const { return (*this)[size() - 1]; }
+
+size_t Scene::pathEnd(size_t k) const {
+    return k + 1 < _starts.size() ? _starts[k + 1] : _x.size();
+}
+
+size_t Scene::pathOf(size_t i) const {
+    auto next = upper_bound(_starts.begin(), _starts.end(), i);
+    return next - _starts.begin() - 1;
+}
+
+Path Scene::path(size_t k, size_t first) const {
+    Path p{(*this)[first]};
+    for (auto i = first + 1; i < pathEnd(k); ++i) p.push_back((*this)[i]);
+
+    return p;
+}
+
+Point Scene::local(const Point &p) const {
+    return p.system == _system ? p : _system.fromGPS(p.toGPS());
+}
+
+void Scene::push(const Point &p) {
+    auto q = local(p);
+    _x.push_back(q.x);
+    _y.push_back(q.y);
+}
+
+Grid::Grid(double cell) : _cell(cell) {}
+
+void Grid::update(const Scene &scene) {
+    if (scene.size() < _indexed) clear();
+
+    // the last segment may still be extended
+    auto end = scene.size() ? scene.size() - 1 : 0;
+    if (_indexed >= end) return;
+
+    auto xs = scene.xs(), ys = scene.ys();
+    for (auto k = scene.pathOf(_indexed); k < scene.paths(); ++k) {
+        auto first = max(_indexed, scene.pathStart(k) + 1);
+        auto last = min(scene.pathEnd(k), end);
+        for (auto i = first; i < last; ++i)
+            insert(i, xs[i - 1], ys[i - 1], xs[i], ys[i]);
+
+        if (scene.pathEnd(k) >= end) break;
+    }
+    _indexed = end;
+}
+
+void Grid::clear() {
+    _indexed = 0;
+    _cells.clear();
+    _large.clear();
+}
+
+void Grid::query(const Scene &scene, const Box &box,
+                 vector<size_t> &out) const {
+    out.clear();
+
+    int x0 = cellOf(box.left), x1 = cellOf(box.right);
+    int y0 = cellOf(box.bottom), y1 = cellOf(box.top);
+    double cells = (double(x1) - x0 + 1) * (double(y1) - y0 + 1);
+    if (cells <= _cells.size()) {
+        for (int64_t cx = x0; cx <= x1; ++cx)
+            for (int64_t cy = y0; cy <= y1; ++cy) {
+                auto found = _cells.find(key(cx, cy));
+                if (found == _cells.end()) continue;
+                out.insert(out.end(), found->second.begin(),
+                           found->second.end());
+            }
+    } else {
+        // a box larger than the indexed area: visit the cells instead
+        for (const auto &cell : _cells) {
+            int cx = int32_t(cell.first >> 32), cy = int32_t(cell.first);
+            if (cx >= x0 && cx <= x1 && cy >= y0 && cy <= y1)
+                out.insert(out.end(), cell.second.begin(), cell.second.end());
+        }
+    }
+    out.insert(out.end(), _large.begin(), _large.end());
+
+    // and the segments not indexed yet
+    for (auto i = max<size_t>(_indexed, 1); i < scene.size(); ++i)
+        if (scene.pathStart(scene.pathOf(i)) != i) out.push_back(i);
+
+    sort(out.begin(), out.end());
+    out.erase(unique(out.begin(), out.end()), out.end());
+
+    auto xs = scene.xs(), ys = scene.ys();
+    out.erase(remove_if(out.begin(), out.end(),
+                        [&](size_t i) {
+                            double t0, t1;
+                            return !box.clip(Point(xs[i - 1], ys[i - 1]),
+                                             Point(xs[i], ys[i]), t0, t1);
+                        }),
+              out.end());
+}
+
+int Grid::cellOf(double v) const {
+    // far away coordinates share the outermost cells
+    double c = floor(v / _cell);
+    return int(max(min(c, double(INT32_MAX)), double(INT32_MIN)));
+}
+
+uint64_t Grid::key(int cx, int cy) {
+    return uint64_t(uint32_t(cx)) << 32 | uint32_t(cy);
+}
+
+void Grid::insert(size_t i, double x0, double y0, double x1, double y1) {
+    int cx0 = cellOf(min(x0, x1)), cx1 = cellOf(max(x0, x1));
+    int cy0 = cellOf(min(y0, y1)), cy1 = cellOf(max(y0, y1));
+    if ((double(cx1) - cx0 + 1) * (double(cy1) - cy0 + 1) > MAX_CELLS) {
+        _large.push_back(i);
+        return;
+    }
+
+    for (int64_t cx = cx0; cx <= cx1; ++cx)
+        for (int64_t cy = cy0; cy <= cy1; ++cy)
+            _cells[key(cx, cy)].push_back(i);
+}
+
 StraightLine::StraightLine(double m, double q, const Reference &system)
     : m(m), q(q), system(system) {}
 
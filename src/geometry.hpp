@@ -6,14 +6,19 @@
 #define __GEOMETRY_HPP_
 
 #include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <unordered_map>
 #include <vector>
 
+#include "allocation.hpp"
+
 namespace mlogo {
 
 namespace geometry {
 
 struct Point;
+class Affine;
 
 class Angle {
 public:
@@ -64,11 +69,23 @@ private:
 
 class Reference {
 public:
-    explicit Reference(double kx = 1, int ox = 0, double ky = 1, int oy = 0);
+    explicit Reference(double kx = 1, double ox = 0, double ky = 1,
+                       double oy = 0);
 
     Point toGPS(const Point &p) const;
     Point fromGPS(const Point &p) const;
 
+    /// The transform from this system to the global one.
+    Affine toGPS() const;
+
+    /**
+     * Bring n points, given as separate coordinate arrays, to the global
+     * system in one pass, with the same double arithmetic as
+     * toGPS(const Point &): every window sees the same coordinates.
+     */
+    void toGPS(const float *xs, const float *ys, std::size_t n, double *outX,
+               double *outY) const;
+
     bool operator==(const Reference &ref) const;
     bool operator!=(const Reference &ref) const;
 
@@ -77,8 +94,8 @@ public:
 private:
     double kx{1};
     double ky{1};
-    int ox{0};
-    int oy{0};
+    double ox{0};
+    double oy{0};
 };
 
 struct Point {
@@ -111,8 +128,40 @@ struct Point {
     Reference system;
 };
 
+/**
+ * 2D affine transform:
+ *     x' = xx * x + xy * y + tx
+ *     y' = yx * x + yy * y + ty
+ */
+class Affine {
+public:
+    static Affine identity();
+    static Affine translation(double x, double y);
+    static Affine translation(const Point &p);
+    static Affine rotation(const Angle &a);
+    static Affine scale(double sx, double sy);
+
+    /// The transform applying other first, then this.
+    Affine operator*(const Affine &other) const;
+
+    /// p transformed, in the same reference system.
+    Point apply(const Point &p) const;
+
+    /**
+     * Transform n points, given as separate coordinate arrays, in one
+     * pass: 8 or 4 at a time when AVX or SSE is enabled at compile time.
+     * The output can be the input.
+     */
+    void apply(const float *xs, const float *ys, std::size_t n, float *outX,
+               float *outY) const;
+
+    double xx{1}, xy{0}, tx{0};
+    double yx{0}, yy{1}, ty{0};
+};
+
 class Path {
-    using Points = std::vector<Point>;
+    using Points =
+        allocation::Vector<Point, allocation::Subsystem::TURTLE_PATHS>;
 
 public:
     using iterator = Points::iterator;
@@ -131,6 +180,9 @@ public:
 
     Path rotate(const Angle &a) const;
 
+    /// Every point transformed by m.
+    Path transform(const Affine &m) const;
+
     Point last() const;
 
     iterator begin() noexcept;
@@ -146,6 +198,136 @@ private:
     Reference system;
 };
 
+/**
+ * Axis-aligned rectangle, sides included, clipping segments with the
+ * Liang-Barsky algorithm: segments are a + t * (b - a), t in [0, 1].
+ * Points are taken in whatever reference system the box is given in.
+ */
+class Box {
+public:
+    /// Where a move leaves the box.
+    struct Exit {
+        double t;         //!< fraction of the move, infinity if never
+        bool vertical;    //!< through the left or the right side
+        bool horizontal;  //!< through the bottom or the top side
+    };
+
+    Box(double left, double bottom, double right, double top);
+
+    bool contains(const Point &p) const;
+
+    /**
+     * The part of segment a-b inside the box is [t0, t1].
+     *
+     * @return false if no part of the segment is inside.
+     */
+    bool clip(const Point &a, const Point &b, double &t0, double &t1) const;
+
+    /// Where p + t * d leaves the box, p being inside.
+    Exit exit(const Point &p, const Point &d) const;
+
+    double left, bottom, right, top;
+};
+
+/**
+ * Many paths in one structure-of-arrays store.
+ *
+ * Coordinates are floats in a single reference system, and each path is
+ * marked by the index of its first point, so a point costs 8 bytes
+ * instead of a whole Point and all the paths share one buffer.
+ */
+class Scene {
+    template <typename T>
+    using Array = allocation::Vector<T, allocation::Subsystem::TURTLE_PATHS>;
+
+public:
+    explicit Scene(const Reference &system = Reference());
+
+    /// Start a new path at p.
+    Scene &moveTo(const Point &p);
+
+    /// Continue the last path to p (or start one, if there is none).
+    Scene &lineTo(const Point &p);
+
+    /**
+     * As lineTo, but if p prolongs the last segment of the last path in
+     * the same direction, the last point is moved to p instead of adding
+     * a new segment.
+     */
+    Scene &extendTo(const Point &p);
+
+    void clear();
+
+    Point operator[](std::size_t i) const;
+    Point last() const;
+
+    std::size_t size() const { return _x.size(); }  //!< number of points
+    bool empty() const { return _x.empty(); }
+
+    std::size_t paths() const { return _starts.size(); }
+
+    /// Points [pathStart(k), pathEnd(k)) belong to path k.
+    std::size_t pathStart(std::size_t k) const { return _starts[k]; }
+    std::size_t pathEnd(std::size_t k) const;
+
+    /// The path point i belongs to.
+    std::size_t pathOf(std::size_t i) const;
+
+    /// Points from first to the end of path k, as a Path.
+    Path path(std::size_t k, std::size_t first) const;
+
+    const float *xs() const { return _x.data(); }
+    const float *ys() const { return _y.data(); }
+    const Reference &system() const { return _system; }
+
+private:
+    static constexpr double COLLINEAR{1e-3};  //!< max distance from the line
+
+    Point local(const Point &p) const;
+    void push(const Point &p);
+
+    Reference _system;
+    Array<float> _x;
+    Array<float> _y;
+    Array<uint32_t> _starts;  //!< first point of each path
+};
+
+/**
+ * Uniform grid over the segments of a Scene, to find those in a box
+ * without visiting the others. A segment is known by the index of its end
+ * point. Segments spanning more than MAX_CELLS cells are kept apart and
+ * always tested.
+ */
+class Grid {
+public:
+    static constexpr double CELL{16};
+    static constexpr std::size_t MAX_CELLS{64};
+
+    explicit Grid(double cell = CELL);
+
+    /**
+     * Index the segments added to scene since the last call; the index is
+     * dropped if scene has shrunk. The last segment may still be extended,
+     * so it is only indexed once another follows.
+     */
+    void update(const Scene &scene);
+    void clear();
+
+    /// The segments of scene crossing box, in ascending order.
+    void query(const Scene &scene, const Box &box,
+               std::vector<std::size_t> &out) const;
+
+private:
+    int cellOf(double v) const;
+    static uint64_t key(int cx, int cy);
+    void insert(std::size_t i, double x0, double y0, double x1, double y1);
+
+    double _cell;
+    std::size_t _indexed{0};  //!< segments ending before it are indexed
+    std::unordered_map<uint64_t, std::vector<uint32_t>> _cells;
+    std::vector<uint32_t> _large;
+};
+
 class StraightLine {
 public:
     static const double VERTICAL;
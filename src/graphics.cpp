@@ -7,11 +7,15 @@
 
 #include "graphics.hpp"
 
+#include <algorithm>
+#include <cstdlib>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 
 #include "graphics_impl.hpp"
+#include "raster.hpp"
+#include "render_thread.hpp"
 
 using namespace std;
 
@@ -19,28 +23,89 @@ namespace mlogo {
 
 namespace graphics {
 
-Context::Context() : _window(nullptr) {
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        stringstream ss;
-        ss << "SDL could not initialize! SDL_Error: " << SDL_GetError();
-        throw logic_error(ss.str());
-        return;
+Window *Window::draw(const geometry::Scene &scene, size_t first) {
+    if (first >= scene.size()) return this;
+
+    for (auto k = scene.pathOf(first); k < scene.paths(); ++k) {
+        // the segment ending at first starts one point before
+        auto from = max(scene.pathStart(k), first ? first - 1 : 0);
+        draw(scene.path(k, from));
     }
+
+    return this;
+}
+
+Window *Window::sprite(const geometry::Path &path) {
+    geometry::Scene scene;
+    scene.moveTo(*path.begin());
+    for (auto iter = path.begin() + 1; iter != path.end(); ++iter)
+        scene.lineTo(*iter);
+
+    return sprites(scene);
 }
 
+Context::Context() : _window(nullptr) {}
+
 Context::~Context() {
     if (_window) delete _window;
 
-    SDL_Quit();
+    if (_sdl) SDL_Quit();
 }
 
 Window *Context::window() {
     if (!_window) {
-        _window = new SDLWindow("mlogo", SCREEN_WIDTH, SCREEN_HEIGHT);
+        RenderThread::Factory open;
+        bool cull{true};  // sub-pixel segments change anti-aliased lines
+
+        if (headless()) {
+            // for the display window only, not the offscreen ones
+            auto env = getenv("MLOGO_SNAPSHOT");
+            string snapshot = env ? env : "";
+            env = getenv("MLOGO_ANTIALIAS");
+            double smooth = env ? max(0.0, atof(env)) : 0;
+            cull = smooth == 0;
+
+            open = [snapshot, smooth]() -> Window * {
+                auto window = new HeadlessWindow(SCREEN_WIDTH, SCREEN_HEIGHT);
+                window->snapshot(snapshot);
+                window->smooth(smooth);
+                return window;
+            };
+        } else {
+            if (!_sdl && SDL_Init(SDL_INIT_VIDEO) < 0) {
+                stringstream ss;
+                ss << "SDL could not initialize! SDL_Error: "
+                   << SDL_GetError();
+                throw logic_error(ss.str());
+            }
+            _sdl = true;
+
+            open = []() -> Window * {
+                return new SDLWindow("mlogo", SCREEN_WIDTH, SCREEN_HEIGHT);
+            };
+        }
+
+        _window = threaded() ? new RenderThread(open, cull) : open();
     }
     return _window;
 }
 
+void Context::sync() {
+    // not window(): nothing is opened just to wait for it
+    if (auto thread = dynamic_cast<RenderThread *>(_window)) thread->sync();
+}
+
+bool Context::headless() {
+    auto env = getenv("MLOGO_DRIVER");
+    return env && string(env) == "headless";
+}
+
+bool Context::threaded() {
+    auto env = getenv("MLOGO_RENDER_THREAD");
+    if (!env || !*env) return headless();
+    return string(env) != "0";
+}
+
 } /* ns: graphics */
 
 } /* ns: mlogo */
@@ -8,6 +8,7 @@
 #ifndef __GRAPHICS_HPP__
 #define __GRAPHICS_HPP__
 
+#include <cstddef>
 #include <cstdint>
 
 #include "geometry.hpp"
@@ -16,6 +17,10 @@ namespace mlogo {
 
 namespace graphics {
 
+namespace raster {
+class Canvas;
+}
+
 struct Color {
     static constexpr uint8_t NO_ALPHA{255};
 
@@ -25,17 +30,56 @@ struct Color {
     uint8_t r, g, b, a;
 };
 
+/**
+ * Drawing surface.
+ *
+ * Paths are drawn once onto a persistent canvas, which is kept between
+ * paints; the sprite is composited on top of the canvas at each paint.
+ */
 class Window {
 public:
     virtual ~Window() {}
 
     virtual Window *background(const Color &color) = 0;
     virtual Window *foreground(const Color &color) = 0;
+
+    /// Erase the canvas.
     virtual Window *clear() = 0;
-    virtual Window *draw(const geometry::Path &path) = 0;
+
+    /// Draw the segments of path starting from point first onto the canvas.
+    virtual Window *draw(const geometry::Path &path, std::size_t first = 0) = 0;
+
+    /**
+     * Draw the segments of scene ending at points [first, scene.size()).
+     * By default each path is handed to draw(Path).
+     */
+    virtual Window *draw(const geometry::Scene &scene, std::size_t first);
+
+    /// Show path on top of the canvas, as the only sprite.
+    Window *sprite(const geometry::Path &path);
+
+    /// Show every path of sprites on top of the canvas: one per turtle.
+    virtual Window *sprites(const geometry::Scene &sprites) = 0;
+    virtual Window *hideSprite() = 0;
+
     virtual Window *setColor(const Color &c) = 0;
+
+    /// Paint with the current color the area of seed's color around it.
+    virtual Window *fill(const geometry::Point &seed) = 0;
+
+    /// Paint with c the inside of polygon, by the even-odd rule.
+    virtual Window *fillPolygon(const geometry::Path &polygon,
+                                const Color &c) = 0;
+
+    /// Show the canvas and the sprite.
     virtual Window *paint() = 0;
 
+    /**
+     * The canvas as drawn so far, without the sprites. It is valid until
+     * the next call to the window.
+     */
+    virtual const raster::Canvas &picture() = 0;
+
 protected:
     Window() {}
 
@@ -57,8 +101,24 @@ public:
         return _instance;
     }
 
+    /**
+     * The window, created on first use: an SDL window, or a HeadlessWindow
+     * if MLOGO_DRIVER is "headless", saved to MLOGO_SNAPSHOT on exit and
+     * drawing lines MLOGO_ANTIALIAS pixels wide if they are set. It is
+     * driven by a RenderThread if threaded().
+     */
     Window *window();
 
+    /// Wait until a RenderThread, if any, has run every command sent.
+    void sync();
+
+    static bool headless();
+    /**
+     * MLOGO_RENDER_THREAD is "1", or unset and the window headless: SDL
+     * windows stay on the main thread unless asked otherwise.
+     */
+    static bool threaded();
+
 private:
     Context();
     ~Context();
@@ -70,6 +130,7 @@ private:
     Context &operator=(Context &&) = delete;
 
     Window *_window;
+    bool _sdl{false};  //!< SDL has been initialized
 };
 }
 }
@@ -20,6 +20,10 @@
 
 #include <SDL2/SDL.h>
 
+#include "allocation.hpp"
+#include "raster.hpp"
+#include "stats.hpp"
+
 namespace mlogo {
 
 namespace graphics {
@@ -39,6 +43,10 @@ inline double zeroif(double val) {
     return val;
 }
 
+using SDLPoints =
+    allocation::Vector<SDL_Point, allocation::Subsystem::GRAPHICS>;
+using SDLRects = allocation::Vector<SDL_Rect, allocation::Subsystem::GRAPHICS>;
+
 SDL_Point toSDLPoint(const geometry::Point &p) {
     SDL_Point out;
     auto point = p.toGPS();
@@ -49,9 +57,28 @@ SDL_Point toSDLPoint(const geometry::Point &p) {
     return out;
 }
 
+/**
+ * Convert points [first, end) of path into out, reusing its storage.
+ * Inner points on the same pixel as the previous one are dropped.
+ */
+void toSDLPoints(const geometry::Path &path, std::size_t first,
+                 SDLPoints &out) {
+    out.clear();
+    out.reserve(path.size() - first);
+    for (auto iter = path.begin() + first; iter != path.end(); ++iter) {
+        auto p = toSDLPoint(*iter);
+        if (!out.empty() && iter + 1 != path.end() && p.x == out.back().x &&
+            p.y == out.back().y)
+            continue;
+
+        out.push_back(p);
+    }
+}
+
 class SDLWindow : public Window {
 public:
-    SDLWindow(const std::string &title, int width, int height) {
+    SDLWindow(const std::string &title, int width, int height)
+        : _readback(width, height) {
         using std::stringstream;
         using std::logic_error;
 
@@ -76,9 +103,28 @@ public:
                << SDL_GetError();
             throw logic_error(ss.str());
         }
+
+        canvas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                   SDL_TEXTUREACCESS_TARGET, width, height);
+
+        if (!canvas) {
+            SDL_DestroyRenderer(renderer);
+            SDL_DestroyWindow(window);
+            window = nullptr;
+
+            stringstream ss;
+            ss << "Canvas could not be created! SDL_Error: " << SDL_GetError();
+            throw logic_error(ss.str());
+        }
+
+        SDL_SetRenderTarget(renderer, canvas);
     }
 
-    ~SDLWindow() { SDL_DestroyWindow(window); }
+    ~SDLWindow() {
+        SDL_DestroyTexture(canvas);
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+    }
 
     Window *background(const Color &color) {
         _background = color;
@@ -97,29 +143,103 @@ public:
         return this;
     }
 
-    Window *draw(const geometry::Path &path) {
-        auto iter = path.begin();
-        auto a = toSDLPoint(*(iter++));
-        while (iter != path.end()) {
-            auto b = toSDLPoint(*(iter++));
-            SDL_RenderDrawLine(renderer, a.x, a.y, b.x, b.y);
+    using Window::draw;
+
+    Window *draw(const geometry::Path &path, std::size_t first) {
+        if (path.size() < first + 2) return this;
+
+        toSDLPoints(path, first, _points);
+        SDL_RenderDrawLines(renderer, _points.data(), _points.size());
+        stats::count(stats::Counter::SEGMENTS, _points.size() - 1);
 
-            a = b;
-        }
         return this;
     }
 
     Window *setColor(const Color &c) {
         SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+        _color = c;
+        return this;
+    }
+
+    Window *fill(const geometry::Point &seed) {
+        readBack();
+        auto p = seed.toGPS();
+        raster::floodSpans(_readback, floor(p.x), floor(p.y), _spans);
+        fillSpans();
+        return this;
+    }
+
+    Window *fillPolygon(const geometry::Path &polygon, const Color &c) {
+        raster::polygonSpans(polygon, _readback.width(), _readback.height(),
+                             _spans);
+
+        SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+        fillSpans();
+        SDL_SetRenderDrawColor(renderer, _color.r, _color.g, _color.b,
+                               _color.a);
+        return this;
+    }
+
+    Window *sprites(const geometry::Scene &sprites) {
+        _sprite.clear();
+        _spriteStarts.clear();
+        for (std::size_t k = 0; k < sprites.paths(); ++k) {
+            toSDLPoints(sprites.path(k, sprites.pathStart(k)), 0, _points);
+            _spriteStarts.push_back(_sprite.size());
+            _sprite.insert(_sprite.end(), _points.begin(), _points.end());
+        }
+
+        return this;
+    }
+
+    Window *hideSprite() {
+        _sprite.clear();
+        _spriteStarts.clear();
         return this;
     }
 
     Window *paint() {
+        SDL_SetRenderTarget(renderer, nullptr);
+        SDL_RenderCopy(renderer, canvas, nullptr, nullptr);
+        for (std::size_t k = 0; k < _spriteStarts.size(); ++k) {
+            auto start = _spriteStarts[k];
+            auto end = k + 1 < _spriteStarts.size() ? _spriteStarts[k + 1]
+                                                    : _sprite.size();
+            if (end - start > 1)
+                SDL_RenderDrawLines(renderer, _sprite.data() + start,
+                                    end - start);
+        }
         SDL_RenderPresent(renderer);
+        SDL_SetRenderTarget(renderer, canvas);
+
+        stats::count(stats::Counter::PRESENTS);
         return this;
     }
 
+    const raster::Canvas &picture() {
+        readBack();
+        return _readback;
+    }
+
 private:
+    /// Copy the canvas texture, the render target, to _readback.
+    void readBack() {
+        SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_RGBA8888,
+                             _readback.data(),
+                             _readback.width() * sizeof(raster::Canvas::Pixel));
+    }
+
+    /// Draw _spans with the render color in one call.
+    void fillSpans() {
+        _rects.clear();
+        _rects.reserve(_spans.size());
+        for (const auto &span : _spans)
+            _rects.push_back({span.x0, span.y, span.x1 - span.x0 + 1, 1});
+
+        if (!_rects.empty())
+            SDL_RenderFillRects(renderer, _rects.data(), _rects.size());
+    }
+
     SDLWindow(const Window &) = delete;
     SDLWindow(Window &&) = delete;
 
@@ -128,8 +248,17 @@ private:
 
     SDL_Window *window{nullptr};
     SDL_Renderer *renderer{nullptr};
+    SDL_Texture *canvas{nullptr};  //!< render target keeping drawn paths
+    SDLPoints _points;  //!< reused by draw()
+    SDLPoints _sprite;  //!< every sprite, one after the other
+    allocation::Vector<std::size_t, allocation::Subsystem::GRAPHICS>
+        _spriteStarts;
     Color _background{0, 0, 0};
     Color _foreground{255, 255, 255};
+    Color _color{_foreground};
+    raster::Canvas _readback;  //!< canvas copy, to fill and to save
+    raster::Spans _spans;
+    SDLRects _rects;
 };
 
 } /* ns: impl */
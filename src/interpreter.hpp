@@ -8,10 +8,13 @@
 #ifndef __INTERPRETER_HPP__
 #define __INTERPRETER_HPP__
 
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
+#include <functional>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "defines.hpp"
 #include "eval.hpp"
@@ -27,9 +30,36 @@ struct InterpreterState {
         return __instance;
     }
 
+    using IdleHook = std::size_t;
+
     void bye() { _running = false; }
     bool running() const { return _running; }
 
+    /// Accept input again after bye().
+    void resume() { _running = true; }
+
+    /**
+     * Register a function to run every time the interpreter waits input.
+     *
+     * @return the handle to unregister it with removeIdle().
+     */
+    IdleHook onIdle(std::function<void()> f) {
+        _idle.emplace_back(++_lastHook, std::move(f));
+        return _lastHook;
+    }
+
+    void removeIdle(IdleHook hook) {
+        _idle.erase(std::remove_if(_idle.begin(), _idle.end(),
+                                   [hook](const auto &h) {
+                                       return h.first == hook;
+                                   }),
+                    _idle.end());
+    }
+
+    void idle() const {
+        for (auto &h : _idle) h.second();
+    }
+
 private:
     InterpreterState() : _running(true) {}
     InterpreterState(const InterpreterState &) = delete;
@@ -39,6 +69,8 @@ private:
     InterpreterState &operator=(InterpreterState &&) = delete;
 
     bool _running;
+    IdleHook _lastHook{0};
+    std::vector<std::pair<IdleHook, std::function<void()>>> _idle;
 };
 
 template <typename InputStream, typename OutputStream,
@@ -66,8 +98,7 @@ public:
         Statement stmt;
 
         showPrompt();
-        while (InterpreterState::instance().running() &&
-               getline(_iStream, str)) {
+        while (InterpreterState::instance().running() && readLine(str)) {
             AST ast;
             try {
                 if (currentProc) {
@@ -134,6 +165,11 @@ public:
     }
 
 protected:
+    bool readLine(std::string &str) {
+        InterpreterState::instance().idle();
+        return static_cast<bool>(std::getline(_iStream, str));
+    }
+
     void showPrompt() {
         if (_interactive) _eStream << "? ";
     }
@@ -0,0 +1,532 @@
+/**
+ * @file: journal.cpp
+ * Implements journal.hpp
+ */
+
+#include "journal.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "raster.hpp"
+
+using namespace std;
+
+namespace mlogo {
+
+namespace journal {
+
+namespace {
+
+const char MAGIC[]{'M', 'L', 'J'};
+
+/// Points kept by the reader before the drawn ones are dropped.
+constexpr size_t REPLAY_BATCH{4096};
+
+uint64_t zigzag(int64_t v) { return uint64_t(v) << 1 ^ uint64_t(v >> 63); }
+
+int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+/// Float bits as an integer growing with the float: close floats are close.
+int64_t ordered(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits >> 31 ? -int64_t(bits & 0x7fffffff) : int64_t(bits);
+}
+
+float unordered(int64_t v) {
+    uint32_t bits = v < 0 ? uint32_t(-v) | 0x80000000 : uint32_t(v);
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/// Far off values fit neither the grid nor a float.
+constexpr double GRID_RANGE{0x1p52}, FLOAT_RANGE{0x1p60};
+
+/// Update last, on both sides, once v is written or read.
+void update(Last &last, double v) {
+    auto subunits = v * SUBUNITS;
+    last.subunits = fabs(subunits) < GRID_RANGE ? llround(subunits) : 0;
+    last.bits = fabs(v) < FLOAT_RANGE ? ordered(float(v)) : 0;
+}
+
+/// Tags of a coordinate, see journal.hpp.
+constexpr uint64_t OFF_GRID{1}, DOUBLE{3};
+
+/// Turtle coordinates of a world width x height scaled by scale pixels.
+geometry::Reference system(int width, int height, double scale) {
+    return geometry::Reference(1 / scale, width * scale / 2, -1 / scale,
+                               height * scale / 2);
+}
+
+/// Draw records of a Drawing onto a window.
+class Player {
+public:
+    Player(graphics::Window *window, const geometry::Reference &system)
+        : _window(window), _system(system), _scene(system) {}
+
+    void play(const Drawing &drawing, const Drawing::Record &record) {
+        switch (record.op) {
+        case Op::CLEAR:
+            clear();
+            break;
+        case Op::MOVE:
+            moveTo(drawing, record.first);
+            break;
+        case Op::LINE:
+            _scene.lineTo(point(drawing, record.first));
+            break;
+        case Op::FILL:
+            // the pen stays where the last line left it
+            draw();
+            _window->fill(point(drawing, record.first));
+            break;
+        case Op::POLYGON: {
+            geometry::Path polygon(point(drawing, record.first));
+            for (auto i = record.first + 1; i < record.first + record.count;
+                 ++i)
+                polygon.push_back(point(drawing, i));
+            draw();
+            _window->fillPolygon(polygon, record.color);
+            break;
+        }
+        }
+    }
+
+    void clear() {
+        _window->clear();
+        _scene.clear();
+        _drawn = 0;
+    }
+
+    void moveTo(const Drawing &drawing, size_t i) {
+        _scene.moveTo(point(drawing, i));
+    }
+
+    void finish() { draw(); }
+
+private:
+    geometry::Point point(const Drawing &drawing, size_t i) const {
+        return geometry::Point(drawing.x[i], drawing.y[i], _system);
+    }
+
+    /// Lines are drawn in batches, before anything that reads the canvas.
+    void draw() {
+        _window->draw(_scene, _drawn);
+        _drawn = _scene.size();
+        if (_drawn < REPLAY_BATCH) return;
+
+        auto last = _scene.last();
+        _scene.clear();
+        _scene.moveTo(last);
+        _drawn = _scene.size();
+    }
+
+    graphics::Window *_window;
+    geometry::Reference _system;
+    geometry::Scene _scene;
+    size_t _drawn{0};
+};
+
+/**
+ * The records drawn on each tile of an image, in order. Moves are left
+ * out: each line carries the point it starts from instead. What comes
+ * before the last clear is left out too.
+ */
+struct Bins {
+    Bins(const Drawing &drawing, double scale, int tile, double margin)
+        : tile(tile),
+          margin(margin),
+          columns((int(drawing.width * scale) + tile - 1) / tile),
+          rows((int(drawing.height * scale) + tile - 1) / tile),
+          scale(scale),
+          cx(drawing.width * scale / 2),
+          cy(drawing.height * scale / 2),
+          records(columns * rows) {
+        const auto &all = drawing.records;
+        size_t start = all.size();
+        while (start && all[start - 1].op != Op::CLEAR) --start;
+
+        size_t pen = NONE;
+        for (auto i = start; i < all.size(); ++i) {
+            const auto &r = all[i];
+            switch (r.op) {
+            case Op::MOVE:
+                pen = r.first;
+                break;
+            case Op::LINE:
+                if (pen != NONE) line(drawing, i, pen);
+                pen = r.first;
+                break;
+            case Op::POLYGON:
+                polygon(drawing, i);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    void play(const Drawing &drawing, size_t tile, Player &player) const {
+        size_t pen = NONE;
+        for (const auto &entry : records[tile]) {
+            const auto &r = drawing.records[entry.record];
+            if (r.op == Op::LINE) {
+                if (pen != entry.from) player.moveTo(drawing, entry.from);
+                pen = r.first;
+            }
+            player.play(drawing, r);
+        }
+        player.finish();
+    }
+
+    static constexpr size_t NONE{~size_t(0)};
+
+
+    struct Entry {
+        size_t record;
+        size_t from;  //!< the point a line starts from
+    };
+
+    int tile;
+    double margin;  //!< how close to a line its pixels are
+    size_t columns, rows;
+    double scale, cx, cy;
+    vector<vector<Entry>> records;  //!< of each tile, row by row
+
+private:
+    double px(const Drawing &d, size_t i) const { return d.x[i] * scale + cx; }
+    double py(const Drawing &d, size_t i) const { return cy - d.y[i] * scale; }
+
+    /// Add record to the tiles over [x0, x1] x [y0, y1], where f holds.
+    template <typename F>
+    void add(double x0, double y0, double x1, double y1, Entry entry, F f) {
+        auto first = [this](double v) {
+            return max(0.0, floor((v - margin) / tile));
+        };
+        auto last = [this](double v, size_t n) {
+            return min(double(n) - 1, floor((v + margin) / tile));
+        };
+
+        for (double r = first(y0); r <= last(y1, rows); ++r)
+            for (double c = first(x0); c <= last(x1, columns); ++c)
+                if (f(c * tile, r * tile))
+                    records[size_t(r) * columns + size_t(c)].push_back(entry);
+    }
+
+    void line(const Drawing &d, size_t i, size_t from) {
+        geometry::Point a(px(d, from), py(d, from));
+        geometry::Point b(px(d, d.records[i].first), py(d, d.records[i].first));
+
+        add(min(a.x, b.x), min(a.y, b.y), max(a.x, b.x), max(a.y, b.y),
+            {i, from}, [this, &a, &b](double x, double y) {
+                geometry::Box box{x - margin, y - margin, x + tile + margin,
+                                  y + tile + margin};
+                double t0, t1;
+                return box.clip(a, b, t0, t1);
+            });
+    }
+
+    void polygon(const Drawing &d, size_t i) {
+        const auto &r = d.records[i];
+        double x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+        for (auto k = r.first; k < r.first + r.count; ++k) {
+            x0 = min(x0, px(d, k));
+            x1 = max(x1, px(d, k));
+            y0 = min(y0, py(d, k));
+            y1 = max(y1, py(d, k));
+        }
+
+        add(x0, y0, x1, y1, {i, NONE}, [](double, double) { return true; });
+    }
+};
+
+}  // namespace
+
+Writer::Writer(ostream &out, int width, int height) : _out(out) {
+    header(width, height);
+}
+
+Writer::Writer(const string &filename, int width, int height)
+    : _file(filename, ios::binary), _out(_file) {
+    if (!_file)
+        throw logic_error("Unable to open journal file " + filename);
+
+    header(width, height);
+}
+
+Writer::~Writer() { flush(); }
+
+void Writer::clear() { op(Op::CLEAR); }
+
+void Writer::moveTo(const geometry::Point &p) {
+    op(Op::MOVE);
+    point(p);
+}
+
+void Writer::lineTo(const geometry::Point &p) {
+    op(Op::LINE);
+    point(p);
+}
+
+void Writer::fill(const geometry::Point &seed) {
+    op(Op::FILL);
+    point(seed);
+}
+
+void Writer::polygon(const geometry::Path &polygon,
+                     const graphics::Color &c) {
+    op(Op::POLYGON);
+    _out.put(char(c.r)).put(char(c.g)).put(char(c.b));
+    varint(polygon.size());
+    for (const auto &p : polygon) point(p);
+}
+
+void Writer::header(int width, int height) {
+    _out.write(MAGIC, sizeof(MAGIC));
+    _out.put(char(VERSION));
+    varint(width);
+    varint(height);
+}
+
+void Writer::point(const geometry::Point &p) {
+    coordinate(p.x, _x);
+    coordinate(p.y, _y);
+}
+
+void Writer::coordinate(double v, Last &last) {
+    auto subunits = v * SUBUNITS;
+    if (fabs(subunits) < GRID_RANGE && subunits == floor(subunits)) {
+        varint(zigzag(int64_t(subunits) - last.subunits) << 1);
+    } else if (fabs(v) < FLOAT_RANGE && double(float(v)) == v) {
+        varint(zigzag(ordered(float(v)) - last.bits) << 2 | OFF_GRID);
+    } else {
+        varint(DOUBLE);
+        uint64_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        for (int i = 0; i < 8; ++i) _out.put(char(bits >> 8 * i));
+    }
+
+    update(last, v);
+}
+
+void Writer::varint(uint64_t v) {
+    while (v >= 0x80) {
+        _out.put(char((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    _out.put(char(v));
+}
+
+Reader::Reader(istream &in) : _in(in) {
+    char magic[sizeof(MAGIC)];
+    if (!_in.read(magic, sizeof(magic)) ||
+        !equal(magic, magic + sizeof(magic), MAGIC))
+        throw runtime_error("Not a journal");
+
+    if (byte() != VERSION)
+        throw runtime_error("Unsupported journal version");
+
+    _width = varint();
+    _height = varint();
+    if (_width <= 0 || _height <= 0)
+        throw runtime_error("Invalid journal size");
+}
+
+bool Reader::next(Drawing &drawing) {
+    auto o = _in.get();
+    if (o == char_traits<char>::eof()) return false;
+
+    Drawing::Record record{Op(o), graphics::Color(0, 0, 0), drawing.x.size(),
+                           1};
+    switch (record.op) {
+    case Op::CLEAR:
+        record.count = 0;
+        break;
+    case Op::MOVE:
+    case Op::LINE:
+    case Op::FILL:
+        point(drawing);
+        break;
+    case Op::POLYGON: {
+        record.color.r = byte();
+        record.color.g = byte();
+        record.color.b = byte();
+        record.count = varint();
+        if (!record.count) throw runtime_error("Empty polygon in journal");
+
+        for (auto n = record.count; n; --n) point(drawing);
+        break;
+    }
+    default:
+        throw runtime_error("Invalid journal record " + to_string(o));
+    }
+
+    drawing.records.push_back(record);
+    return true;
+}
+
+Drawing Reader::read() {
+    Drawing drawing;
+    drawing.width = _width;
+    drawing.height = _height;
+    while (next(drawing)) {
+    }
+
+    return drawing;
+}
+
+size_t Reader::replay(graphics::Window *window, double scale) {
+    Player player(window, system(_width, _height, scale));
+
+    // one record at a time, in constant memory
+    Drawing drawing;
+    size_t records = 0;
+    for (; next(drawing); drawing.clear(), ++records)
+        player.play(drawing, drawing.records.front());
+
+    player.finish();
+    window->paint();
+    return records;
+}
+
+uint64_t Reader::varint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        auto b = byte();
+        v |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+
+    throw runtime_error("Invalid varint in journal");
+}
+
+void Reader::point(Drawing &drawing) {
+    drawing.x.push_back(coordinate(_x));
+    drawing.y.push_back(coordinate(_y));
+}
+
+double Reader::coordinate(Last &last) {
+    auto v = varint();
+
+    double value;
+    if (v == DOUBLE) {
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) bits |= uint64_t(byte()) << 8 * i;
+        memcpy(&value, &bits, sizeof(value));
+    } else if (v & OFF_GRID) {
+        value = unordered(last.bits + unzigzag(v >> 2));
+    } else {
+        value = double(last.subunits + unzigzag(v >> 1)) / SUBUNITS;
+    }
+
+    update(last, value);
+    return value;
+}
+
+uint8_t Reader::byte() {
+    auto b = _in.get();
+    if (b == char_traits<char>::eof())
+        throw runtime_error("Truncated journal");
+    return uint8_t(b);
+}
+
+bool Drawing::has(Op op) const {
+    return any_of(records.begin(), records.end(),
+                  [op](const Record &r) { return r.op == op; });
+}
+
+void Drawing::clear() {
+    records.clear();
+    x.clear();
+    y.clear();
+}
+
+void renderTiled(const Drawing &drawing, double scale, int tile,
+                 unsigned threads, ostream &out, double smooth) {
+    if (drawing.has(Op::FILL))
+        throw logic_error("Flood fills need the whole canvas");
+
+    int width = drawing.width * scale, height = drawing.height * scale;
+    if (width <= 0 || height <= 0 || tile <= 0)
+        throw logic_error("Invalid image or tile size");
+
+    // truncated end points move Bresenham lines by less than 2 pixels
+    Bins bins(drawing, scale, tile, max(2.0, smooth / 2 + 1));
+    size_t columns = bins.columns, rows = bins.rows, tiles = columns * rows;
+
+    // rows of tiles are done in the band they are put in, two at most
+    vector<graphics::raster::Canvas::Pixel> bands[2];
+    for (auto &band : bands) band.resize(size_t(width) * tile);
+
+    mutex m;
+    condition_variable changed;
+    size_t nextTile = 0, written = 0, done[2] = {0, 0};
+
+    auto worker = [&]() {
+        graphics::HeadlessWindow window(tile, tile);
+        window.smooth(smooth);
+        Player player(&window, system(drawing.width, drawing.height, scale));
+        for (;;) {
+            size_t t;
+            {
+                unique_lock<mutex> lock(m);
+                changed.wait(lock, [&]() {
+                    return nextTile == tiles ||
+                           nextTile / columns < written + 2;
+                });
+                if (nextTile == tiles) return;
+                t = nextTile++;
+            }
+
+            int x0 = t % columns * tile, y0 = t / columns * tile;
+            window.tile(x0, y0, width, height);
+            player.clear();
+            bins.play(drawing, t, player);
+
+            // only the part of the tile on the image
+            auto &band = bands[t / columns % 2];
+            auto pixels = window.canvas().data();
+            int w = min(tile, width - x0), h = min(tile, height - y0);
+            for (int y = 0; y < h; ++y)
+                copy_n(pixels + size_t(y) * tile, w,
+                       band.data() + size_t(y) * width + x0);
+
+            lock_guard<mutex> lock(m);
+            if (++done[t / columns % 2] == columns) changed.notify_all();
+        }
+    };
+
+    vector<thread> workers;
+    for (unsigned i = 0; i < max(threads, 1u); ++i)
+        workers.emplace_back(worker);
+
+    graphics::raster::writePPMHeader(out, width, height);
+    for (size_t row = 0; row < rows; ++row) {
+        {
+            unique_lock<mutex> lock(m);
+            changed.wait(lock, [&]() { return done[row % 2] == columns; });
+        }
+
+        auto h = min(tile, height - int(row) * tile);
+        graphics::raster::writePPMPixels(out, bands[row % 2].data(),
+                                         size_t(width) * h);
+
+        lock_guard<mutex> lock(m);
+        done[row % 2] = 0;
+        ++written;
+        changed.notify_all();
+    }
+
+    for (auto &w : workers) w.join();
+}
+
+} /* ns: journal */
+
+} /* ns: mlogo */
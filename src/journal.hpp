@@ -0,0 +1,176 @@
+/**
+ * @file: journal.hpp
+ *
+ * Binary journal of the drawing, replayable offline.
+ *
+ * The journal records what the turtles draw, in turtle coordinates, so
+ * that the drawing can be rendered again at any resolution without running
+ * the Logo program. After a header it is a sequence of records, an opcode
+ * byte followed by its operands. Coordinates are kept exact, so that a
+ * replay at scale 1 is the live canvas, pixel for pixel, whether it is
+ * drawn directly or behind the render thread. Each one is a varint v:
+ *
+ *     v even          on the grid of 1/SUBUNITS of a step: zigzag(v >> 1)
+ *                     subunits from the previous coordinate
+ *     v odd, not 3    a float: zigzag(v >> 2) from the previous coordinate,
+ *                     comparing the bits of the floats as integers
+ *     v == 3          a double, in the 8 bytes that follow
+ *
+ * Lines come from the scene, which holds floats, so a short move takes one
+ * or two bytes per axis on the grid and two to four off it.
+ *
+ *     header  := "MLJ" VERSION varint(width) varint(height)
+ *     CLEAR
+ *     MOVE    dx dy         pen up to (x, y)
+ *     LINE    dx dy         line from the pen to (x, y)
+ *     FILL    dx dy         flood fill from (x, y) with the pen color
+ *     POLYGON r g b varint(n) (dx dy){n}
+ *
+ * Turns, pen state and turtle modes are not recorded as such: replaying
+ * their effect on the drawing, MOVE and LINE, needs no turtle logic and
+ * gives the same picture whatever the program did to get there.
+ *
+ * Recording is turned on by setting the MLOGO_JOURNAL environment variable
+ * to the name of the output file; mlogo-render replays it.
+ */
+
+#ifndef __JOURNAL_HPP__
+#define __JOURNAL_HPP__
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "geometry.hpp"
+#include "graphics.hpp"
+
+namespace mlogo {
+
+namespace journal {
+
+static constexpr uint8_t VERSION{2};
+static constexpr int SUBUNITS{16};
+
+enum class Op : uint8_t { CLEAR, MOVE, LINE, FILL, POLYGON };
+
+/// The previous value of a coordinate, as both encodings see it.
+struct Last {
+    int64_t subunits{0};
+    int64_t bits{0};  //!< of the nearest float, ordered as integers
+};
+
+class Writer {
+public:
+    /**
+     * Record into out a world of width x height turtle steps.
+     * @throw std::logic_error if filename cannot be opened.
+     */
+    Writer(std::ostream &out, int width, int height);
+    Writer(const std::string &filename, int width, int height);
+    ~Writer();
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    /// Points are taken in turtle coordinates: p.x and p.y.
+    void clear();
+    void moveTo(const geometry::Point &p);
+    void lineTo(const geometry::Point &p);
+    void fill(const geometry::Point &seed);
+    void polygon(const geometry::Path &polygon, const graphics::Color &c);
+
+    void flush() { _out.flush(); }
+
+private:
+    void header(int width, int height);
+    void op(Op o) { _out.put(char(o)); }
+    void point(const geometry::Point &p);
+    void coordinate(double v, Last &last);
+    void varint(uint64_t v);
+
+    std::ofstream _file;
+    std::ostream &_out;
+    Last _x, _y;  //!< the last coordinates written
+};
+
+/// A journal read in memory.
+struct Drawing {
+    struct Record {
+        Op op;
+        graphics::Color color;  //!< of a POLYGON
+        std::size_t first;      //!< its points are [first, first + count)
+        std::size_t count;
+    };
+
+    int width{0}, height{0};  //!< of the world, in turtle steps
+    std::vector<Record> records;
+    std::vector<double> x, y;  //!< the points, in turtle coordinates
+
+    bool has(Op op) const;
+    void clear();
+};
+
+class Reader {
+public:
+    /// @throw std::runtime_error if in is not a journal.
+    explicit Reader(std::istream &in);
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+
+    /**
+     * Append the next record to drawing.
+     *
+     * @return false at the end of the journal.
+     * @throw std::runtime_error on a malformed record.
+     */
+    bool next(Drawing &drawing);
+
+    /// The rest of the journal.
+    Drawing read();
+
+    /**
+     * Draw the rest of the journal onto window, turtle steps scaled by
+     * scale pixels about the center, record by record. The window should
+     * be width() x height() times scale.
+     *
+     * @return the records replayed.
+     * @throw std::runtime_error on a malformed record.
+     */
+    std::size_t replay(graphics::Window *window, double scale);
+
+private:
+    uint64_t varint();
+    void point(Drawing &drawing);
+    double coordinate(Last &last);
+    uint8_t byte();
+
+    std::istream &_in;
+    int _width{0}, _height{0};
+    Last _x, _y;
+};
+
+/**
+ * Draw drawing scaled by scale, as Reader::replay() does, and write it to
+ * out as binary PPM, for images too large to keep in memory.
+ *
+ * The image is cut into tile x tile squares. Records are binned to the
+ * squares they cross, and threads workers rasterize each square with only
+ * its own records. A row of squares is written out as soon as it is done
+ * and at most two rows are kept, so memory grows with the width of the
+ * image, not with its area. Lines are anti-aliased, smooth pixels wide,
+ * unless smooth is 0.
+ *
+ * @throw std::logic_error if drawing has flood fills, which need the
+ * whole canvas.
+ */
+void renderTiled(const Drawing &drawing, double scale, int tile,
+                 unsigned threads, std::ostream &out, double smooth = 0);
+
+} /* ns: journal */
+
+} /* ns: mlogo */
+
+#endif /* __JOURNAL_HPP__ */
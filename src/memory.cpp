@@ -16,6 +16,10 @@
 #include <boost/algorithm/string.hpp>
 
 #include "exceptions.hpp"
+#include "perf.hpp"
+#include "profiler.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 
 using namespace std;
 using namespace mlogo::exceptions;
@@ -107,9 +111,11 @@ Stack::Stack() : frames(1) {
 
 void Stack::callProcedure(const std::string &name, ActualArguments args,
                           const std::string &returnIn) {
-    auto iter =
-        find_if(frames.rbegin(), frames.rend(),
-                [this, &name](Frame &f) { return f.hasProcedure(name); });
+    trace::Scope traceScope("call", name);
+    profiler::Frame profileFrame(name);
+    perf::PhaseScope phase(perf::Phase::EVAL);
+
+    auto iter = findProcedure(name);
 
     if (iter != frames.rend()) {
         auto &func = *iter->getProcedure(name);
@@ -132,9 +138,7 @@ void Stack::callProcedure(const std::string &name, ActualArguments args,
 }
 
 ProcedurePtr Stack::getProcedure(const std::string &name) {
-    auto iter =
-        find_if(frames.rbegin(), frames.rend(),
-                [this, &name](Frame &f) { return f.hasProcedure(name); });
+    auto iter = findProcedure(name);
 
     if (iter != frames.rend()) {
         return iter->getProcedure(name);
@@ -143,17 +147,13 @@ ProcedurePtr Stack::getProcedure(const std::string &name) {
 }
 
 bool Stack::hasProcedure(const std::string &name) {
-    auto iter =
-        find_if(frames.rbegin(), frames.rend(),
-                [this, &name](Frame &f) { return f.hasProcedure(name); });
+    auto iter = findProcedure(name);
 
     return iter != frames.rend();
 }
 
 std::size_t Stack::getProcedureNArgs(const std::string &name) {
-    auto iter =
-        find_if(frames.rbegin(), frames.rend(),
-                [this, &name](Frame &f) { return f.hasProcedure(name); });
+    auto iter = findProcedure(name);
 
     if (iter != frames.rend()) {
         auto &func = *iter->getProcedure(name);
@@ -167,6 +167,10 @@ ValueBox &Stack::getVariable(const std::string &name) {
         find_if(frames.rbegin(), frames.rend(),
                 [this, &name](Frame &f) { return f.hasVariable(name); });
 
+    stats::count(stats::Counter::VARIABLE_LOOKUPS);
+    stats::count(stats::Counter::FRAME_WALKS,
+                 distance(frames.rbegin(), iter) + (iter != frames.rend()));
+
     if (iter != frames.rend()) {
         return iter->getVariable(name);
     }
@@ -213,6 +217,7 @@ Stack &Stack::setProcedure(const parser::Procedure &definition) {
 }
 
 Stack &Stack::openFrame() {
+    stats::count(stats::Counter::FRAMES);
     frames.push_back(Frame());
     return *this;
 }
@@ -237,6 +242,19 @@ Stack &Stack::closeFrame() {
     return *this;
 }
 
+FrameList::reverse_iterator Stack::findProcedure(const std::string &name) {
+    auto iter =
+        find_if(frames.rbegin(), frames.rend(),
+                [this, &name](Frame &f) { return f.hasProcedure(name); });
+
+    auto misses = distance(frames.rbegin(), iter);
+    stats::count(stats::Counter::PROCEDURE_MISSES, misses);
+    stats::count(stats::Counter::FRAME_WALKS,
+                 misses + (iter != frames.rend()));
+
+    return iter;
+}
+
 std::string Stack::argumentName(uint8_t index) const {
     stringstream ss;
     ss << __ARGUMENT_PREFIX << index;
@@ -16,6 +16,7 @@
 #include <utility>
 #include <vector>
 
+#include "allocation.hpp"
 #include "defines.hpp"
 #include "parser.hpp"
 #include "types.hpp"
@@ -66,13 +67,19 @@ public:
     Frame &clear();
 
 private:
-    std::map<std::string, ProcedurePtr> procedures;
-    std::map<std::string, ValueBox> variables;
+    template <typename T>
+    using Table = std::map<
+        std::string, T, std::less<std::string>,
+        allocation::Allocator<std::pair<const std::string, T>,
+                              allocation::Subsystem::FRAMES>>;
+
+    Table<ProcedurePtr> procedures;
+    Table<ValueBox> variables;
     ValueBox _lastResult;
     std::string _lastResultVariable;
     mutable bool hasResultSetted{false};
 };
-using FrameList = std::vector<Frame>;
+using FrameList = allocation::Vector<Frame, allocation::Subsystem::FRAMES>;
 
 class Stack {
 public:
@@ -140,6 +147,7 @@ private:
     Stack &operator=(Stack &&) = delete;
 
     std::string argumentName(uint8_t index) const;
+    FrameList::reverse_iterator findProcedure(const std::string &name);
 
     FrameList frames;
 };
@@ -0,0 +1,137 @@
+/**
+ * @file: mlogo_render.cpp
+ *
+ * mlogo-render: draw a journal recorded with MLOGO_JOURNAL again, at any
+ * resolution, without running the Logo program.
+ *
+ *     mlogo-render [-s SCALE | -w WIDTH] [-a PEN] [-t TILE] [-j THREADS]
+ *                  JOURNAL OUTPUT
+ *
+ * The picture is SCALE times the size of the turtle window, or WIDTH pixels
+ * wide, with anti-aliased lines PEN pixels wide if given. OUTPUT is a binary
+ * PPM file, or - for the standard output.
+ *
+ * Pictures over 16 megapixels, or any with -t, are rasterized in
+ * TILE x TILE squares by THREADS workers (all the cores by default) and
+ * streamed out, so that print-sized pictures fit in memory; journals with
+ * flood fills are always drawn on a whole canvas.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "journal.hpp"
+#include "raster.hpp"
+
+using namespace std;
+using namespace mlogo;
+
+namespace {
+
+constexpr double LARGE{4096.0 * 4096.0};
+constexpr int DEFAULT_TILE{512};
+
+struct Options {
+    double scale{1};
+    int width{0};  //!< overrides scale
+    double pen{0};  //!< width of anti-aliased lines
+    int tile{0};
+    unsigned threads{thread::hardware_concurrency()};
+};
+
+int usage(const char *program) {
+    cerr << "Usage: " << program
+         << " [-s SCALE | -w WIDTH] [-a PEN] [-t TILE] [-j THREADS]"
+            " JOURNAL OUTPUT"
+         << endl;
+    return 2;
+}
+
+void render(istream &in, ostream &out, Options options) {
+    journal::Reader reader(in);
+    auto scale = options.width ? double(options.width) / reader.width()
+                               : options.scale;
+    int width = reader.width() * scale, height = reader.height() * scale;
+    if (width <= 0 || height <= 0) throw runtime_error("Scale too small");
+
+    auto tile = options.tile;
+    if (!tile && double(width) * height > LARGE) tile = DEFAULT_TILE;
+
+    if (tile) {
+        auto drawing = reader.read();
+        if (!drawing.has(journal::Op::FILL)) {
+            journal::renderTiled(drawing, scale, tile, options.threads, out,
+                                 options.pen);
+            cerr << drawing.records.size() << " records, " << width << "x"
+                 << height << " in " << tile << "x" << tile << " tiles"
+                 << endl;
+            return;
+        }
+
+        cerr << "Flood fills: drawing on a whole canvas" << endl;
+        in.clear();
+        in.seekg(0);
+        options.scale = scale;
+        options.width = 0;
+        options.tile = 0;
+        return render(in, out, options);
+    }
+
+    graphics::HeadlessWindow window(width, height);
+    if (options.pen) window.smooth(options.pen);
+    auto records = reader.replay(&window, scale);
+    window.canvas().writePPM(out);
+
+    cerr << records << " records, " << width << "x" << height << endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    int arg = 1;
+
+    for (; arg + 1 < argc && argv[arg][0] == '-' && argv[arg][1]; arg += 2) {
+        auto value = argv[arg + 1];
+        if (!strcmp(argv[arg], "-s"))
+            options.scale = atof(value);
+        else if (!strcmp(argv[arg], "-w"))
+            options.width = atoi(value);
+        else if (!strcmp(argv[arg], "-a"))
+            options.pen = atof(value);
+        else if (!strcmp(argv[arg], "-t"))
+            options.tile = atoi(value);
+        else if (!strcmp(argv[arg], "-j"))
+            options.threads = atoi(value);
+        else
+            return usage(argv[0]);
+    }
+
+    if (argc - arg != 2 || options.scale <= 0 || options.width < 0 ||
+        options.pen < 0 || options.tile < 0)
+        return usage(argv[0]);
+
+    string input = argv[arg], output = argv[arg + 1];
+    try {
+        ifstream in(input, ios::binary);
+        if (!in) throw runtime_error("Unable to open " + input);
+
+        if (output == "-") {
+            render(in, cout, options);
+        } else {
+            ofstream out(output, ios::binary);
+            if (!out) throw runtime_error("Unable to open " + output);
+            render(in, out, options);
+        }
+    } catch (const exception &e) {
+        cerr << argv[0] << ": " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
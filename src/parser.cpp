@@ -15,6 +15,10 @@
 
 #include <boost/algorithm/string.hpp>
 
+#include "perf.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+
 namespace mlogo {
 
 namespace parser {
@@ -25,6 +29,9 @@ using Parser = StatementParser<iterator_type>;
 /// To disambiguate the minus symbol, for unary operator we use this
 static const char MINUS_SYMBOL{'_'};
 
+/// Trace event name for parse()
+static const std::string PARSE_TRACE_NAME{"parse"};
+
 const Expression Expression::MINUS{MINUS_SYMBOL};
 
 namespace {
@@ -280,6 +287,10 @@ std::vector<Variable> Procedure::parameters() const {
 }
 
 Statement parse(const std::string &line) {
+    trace::Scope traceScope("parser", PARSE_TRACE_NAME);
+    stats::count(stats::Counter::PARSES);
+    perf::PhaseScope phase(perf::Phase::PARSE);
+
     auto stmt = parse<StatementParser, Statement>(line);
 
     if (stmt.isStartProcedure()) {
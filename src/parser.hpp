@@ -14,6 +14,7 @@
 #include <boost/fusion/include/adapt_struct.hpp>
 #include <boost/variant.hpp>
 
+#include "allocation.hpp"
 #include "defines.hpp"
 
 namespace mlogo {
@@ -95,7 +96,7 @@ struct Expression {
 
     std::string name{"0"};
     Node node{Node::NUMBER};
-    std::vector<Expression> children;
+    allocation::Vector<Expression, allocation::Subsystem::PARSE_TREE> children;
 
     Expression();
     Expression(const Number &name);
@@ -131,9 +132,12 @@ private:
 
 using Argument = boost::variant<ProcName, Word, List, Expression, Statement>;
 
-struct Statement {
+struct Statement : allocation::Accounted<allocation::Subsystem::PARSE_TREE> {
+    using Arguments =
+        allocation::Vector<Argument, allocation::Subsystem::PARSE_TREE>;
+
     ProcName name;
-    std::vector<Argument> arguments;
+    Arguments arguments;
 
     Statement() {}
     Statement(const Statement &stmt);
@@ -153,7 +157,7 @@ struct Statement {
 
 struct Procedure {
     Statement prototype;
-    std::vector<Statement> lines;
+    allocation::Vector<Statement, allocation::Subsystem::PARSE_TREE> lines;
 
     Procedure(const Statement &prototype);
 
@@ -206,7 +210,7 @@ struct DisplayArgumentVisitor : boost::static_visitor<std::string> {
 BOOST_FUSION_ADAPT_STRUCT(
         mlogo::parser::Statement,
         (mlogo::parser::ProcName, name)
-        (std::vector<mlogo::parser::Argument>, arguments))
+        (mlogo::parser::Statement::Arguments, arguments))
 // clang-format on
 
 #endif
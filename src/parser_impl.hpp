@@ -104,7 +104,11 @@ struct ProcNameParser : qi::grammar<Iterator, ProcName()> {
         using ascii::alpha;
         using ascii::punct;
 
-        procname = alpha >> *((punct - ';' - '[' - ']' - '(' - ')') | alnum);
+        using ascii::char_;
+
+        // a leading dot is allowed for internal procedures (.STATS)
+        procname = -char_('.') >> alpha >>
+                   *((punct - ';' - '[' - ']' - '(' - ')') | alnum);
         start = procname;
     }
 
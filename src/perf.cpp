@@ -0,0 +1,250 @@
+/**
+ * @file: perf.cpp
+ * Implements perf.hpp
+ */
+
+#include "perf.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace mlogo {
+
+namespace perf {
+
+namespace {
+
+int openEvent(uint64_t config, int group) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = (group == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+uint64_t eventConfig(Event e) {
+    switch (e) {
+    case Event::CYCLES:
+        return PERF_COUNT_HW_CPU_CYCLES;
+    case Event::INSTRUCTIONS:
+        return PERF_COUNT_HW_INSTRUCTIONS;
+    case Event::CACHE_MISSES:
+        return PERF_COUNT_HW_CACHE_MISSES;
+    case Event::BRANCH_MISSES:
+        return PERF_COUNT_HW_BRANCH_MISSES;
+    case Event::EVENTS:
+        break;
+    }
+
+    throw logic_error("Unknown performance event.");
+}
+
+double ratio(uint64_t a, uint64_t b) { return b ? double(a) / b : 0.0; }
+
+}  // namespace
+
+Counters::Counters() {
+    _fds.fill(-1);
+    _slots.fill(-1);
+
+    auto env = getenv("MLOGO_PERF");
+    if (env && *env) {
+        try {
+            start();
+            _reportOnExit = true;
+        } catch (logic_error &e) {
+            cerr << e.what() << endl;
+        }
+    }
+}
+
+Counters::~Counters() {
+    if (_reportOnExit) {
+        stop();
+        report(cerr);
+    }
+    stop();
+}
+
+void Counters::start() {
+    stop();
+    _slots.fill(-1);
+
+    for (size_t i = 0; i < Metrics::EVENTS; ++i) {
+        auto e = static_cast<Event>(i);
+        int fd = openEvent(eventConfig(e), _fds[0]);
+
+        if (fd < 0) {
+            if (e == Event::CYCLES) {
+                stringstream ss;
+                ss << "Hardware counters unavailable: perf_event_open: "
+                   << strerror(errno);
+                throw logic_error(ss.str());
+            }
+            continue;  // missing members are reported as n/a
+        }
+
+        _fds[i] = fd;
+        _slots[i] = _nOpened++;
+    }
+
+    ioctl(_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    _phases.clear();
+    _last = read();
+    _lastTime = Clock::now();
+    _active = true;
+}
+
+void Counters::stop() {
+    if (_active) charge();
+
+    _active = false;
+    _phases.clear();
+    _nOpened = 0;
+    for (auto &fd : _fds) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+}
+
+bool Counters::available(Event e) const {
+    return _slots[static_cast<size_t>(e)] >= 0;
+}
+
+void Counters::enter(Phase p) {
+    charge();
+    _phases.push_back(p);
+    ++_metrics[static_cast<size_t>(p)].calls;
+}
+
+void Counters::leave() {
+    if (_phases.empty()) return;
+
+    charge();
+    _phases.pop_back();
+}
+
+void Counters::reset() {
+    for (auto &m : _metrics) m = Metrics();
+}
+
+void Counters::charge() {
+    auto now = read();
+    auto time = Clock::now();
+
+    if (!_phases.empty()) {
+        auto &m = _metrics[static_cast<size_t>(_phases.back())];
+        for (size_t i = 0; i < Metrics::EVENTS; ++i)
+            m.events[i] += now[i] - _last[i];
+        m.nanoseconds +=
+            chrono::duration_cast<chrono::nanoseconds>(time - _lastTime)
+                .count();
+    }
+
+    _last = now;
+    _lastTime = time;
+}
+
+Counters::Sample Counters::read() const {
+    Sample sample{};
+    if (_fds[0] < 0) return sample;
+
+    uint64_t buffer[1 + Metrics::EVENTS];
+    if (::read(_fds[0], buffer, sizeof(buffer)) <= 0) return sample;
+
+    for (size_t i = 0; i < Metrics::EVENTS; ++i) {
+        if (_slots[i] >= 0 && uint64_t(_slots[i]) < buffer[0])
+            sample[i] = buffer[1 + _slots[i]];
+    }
+
+    return sample;
+}
+
+ostream &Counters::report(ostream &s) const {
+    auto flags = s.flags();
+    auto precision = s.precision();
+
+    s << setw(8) << left << "phase" << setw(10) << right << "calls"
+      << setw(12) << "ms";
+    for (size_t i = 0; i < Metrics::EVENTS; ++i)
+        s << setw(16) << name(static_cast<Event>(i));
+    s << setw(8) << "IPC" << endl;
+
+    for (size_t p = 0; p < _metrics.size(); ++p) {
+        auto &m = _metrics[p];
+        s << setw(8) << left << name(static_cast<Phase>(p)) << setw(10)
+          << right << m.calls << setw(12) << fixed << setprecision(3)
+          << m.nanoseconds / 1e6;
+
+        for (size_t i = 0; i < Metrics::EVENTS; ++i) {
+            if (available(static_cast<Event>(i)) || m.events[i])
+                s << setw(16) << m.events[i];
+            else
+                s << setw(16) << "n/a";
+        }
+
+        s << setw(8) << setprecision(2)
+          << ratio(m[Event::INSTRUCTIONS], m[Event::CYCLES]) << endl;
+    }
+
+    s.flags(flags);
+    s.precision(precision);
+    return s;
+}
+
+const char *Counters::name(Phase p) {
+    switch (p) {
+    case Phase::PARSE:
+        return "parse";
+    case Phase::COMPILE:
+        return "compile";
+    case Phase::EVAL:
+        return "eval";
+    case Phase::RENDER:
+        return "render";
+    case Phase::PHASES:
+        break;
+    }
+
+    return "unknown";
+}
+
+const char *Counters::name(Event e) {
+    switch (e) {
+    case Event::CYCLES:
+        return "cycles";
+    case Event::INSTRUCTIONS:
+        return "instructions";
+    case Event::CACHE_MISSES:
+        return "cache-misses";
+    case Event::BRANCH_MISSES:
+        return "branch-misses";
+    case Event::EVENTS:
+        break;
+    }
+
+    return "unknown";
+}
+
+} /* ns: perf */
+
+} /* ns: mlogo */
@@ -0,0 +1,144 @@
+/**
+ * @file: perf.hpp
+ *
+ * Hardware performance counters per interpreter phase.
+ *
+ * Cycles, instructions, cache misses and branch misses of the interpreter
+ * thread are read with perf_event_open(2) every time the interpreter moves
+ * from a phase to another (parse, compile, eval, render). Phases nest, but
+ * each delta is charged only to the innermost phase, so the report shows
+ * exclusive costs. With a RenderThread, render is only the work of queueing
+ * the drawing: rasterizing it happens on the other thread, not counted.
+ *
+ * Counting is turned on by setting MLOGO_PERF (the report is printed on
+ * exit) or at runtime with PERF.START, PERF.STOP and PERF.REPORT.
+ */
+
+#ifndef __PERF_HPP__
+#define __PERF_HPP__
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace mlogo {
+
+namespace perf {
+
+enum class Phase { PARSE, COMPILE, EVAL, RENDER, PHASES };
+
+enum class Event { CYCLES, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES, EVENTS };
+
+struct Metrics {
+    static constexpr std::size_t EVENTS{static_cast<std::size_t>(
+        Event::EVENTS)};
+
+    uint64_t calls{0};
+    uint64_t nanoseconds{0};
+    std::array<uint64_t, EVENTS> events{};
+
+    uint64_t operator[](Event e) const {
+        return events[static_cast<std::size_t>(e)];
+    }
+};
+
+class Counters {
+public:
+    static Counters &instance() {
+        static Counters _instance;
+        return _instance;
+    }
+
+    /**
+     * Open the hardware counters for the current thread.
+     *
+     * @throw std::logic_error if perf events are not available (no PMU,
+     *        perf_event_paranoid too strict, ...).
+     */
+    void start();
+
+    /// Close the counters. Collected metrics are kept.
+    void stop();
+
+    bool active() const { return _active; }
+
+    /// True if the event could be opened by the last start().
+    bool available(Event e) const;
+
+    void enter(Phase p);
+    void leave();
+
+    const Metrics &metrics(Phase p) const {
+        return _metrics[static_cast<std::size_t>(p)];
+    }
+
+    void reset();
+
+    std::ostream &report(std::ostream &s) const;
+
+    static const char *name(Phase p);
+    static const char *name(Event e);
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Sample = std::array<uint64_t, Metrics::EVENTS>;
+
+    Counters();
+    ~Counters();
+
+    Counters(const Counters &) = delete;
+    Counters(Counters &&) = delete;
+
+    Counters &operator=(const Counters &) = delete;
+    Counters &operator=(Counters &&) = delete;
+
+    /// Charge everything since the last transition to the current phase.
+    void charge();
+    Sample read() const;
+
+    bool _active{false};
+    bool _reportOnExit{false};
+    std::array<int, Metrics::EVENTS> _fds;
+    std::array<int, Metrics::EVENTS> _slots;  //!< position in group read
+    std::size_t _nOpened{0};
+
+    std::vector<Phase> _phases;
+    Sample _last{};
+    Clock::time_point _lastTime;
+    std::array<Metrics, static_cast<std::size_t>(Phase::PHASES)> _metrics;
+};
+
+/**
+ * Account the lifetime of this object to a phase.
+ * It does nothing while counters are off.
+ */
+class PhaseScope {
+public:
+    explicit PhaseScope(Phase p) {
+        auto &counters = Counters::instance();
+        if (counters.active()) {
+            counters.enter(p);
+            _entered = true;
+        }
+    }
+
+    ~PhaseScope() {
+        // counters may have been stopped inside this phase
+        if (_entered && Counters::instance().active())
+            Counters::instance().leave();
+    }
+
+private:
+    PhaseScope(const PhaseScope &) = delete;
+    PhaseScope &operator=(const PhaseScope &) = delete;
+
+    bool _entered{false};
+};
+
+} /* ns: perf */
+
+} /* ns: mlogo */
+
+#endif /* __PERF_HPP__ */
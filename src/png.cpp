@@ -0,0 +1,816 @@
+/**
+ * @file: png.cpp
+ * Implements png.hpp
+ */
+
+#include "png.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "raster.hpp"
+
+using namespace std;
+
+namespace mlogo {
+
+namespace png {
+
+namespace {
+
+using Bytes = vector<uint8_t>;
+using Frequencies = vector<uint32_t>;
+
+const uint8_t SIGNATURE[]{137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+
+constexpr size_t STRIPE{1 << 20};  //!< filtered bytes a stripe aims at
+constexpr size_t BLOCK{1 << 16};   //!< symbols in a deflate block
+constexpr size_t STORED{65535};    //!< bytes in a stored block
+constexpr size_t WINDOW{1 << 15};
+constexpr int MIN_MATCH{3};
+constexpr int MAX_MATCH{258};
+constexpr int HASH_BITS{15};
+constexpr int BYTES_PER_PIXEL{3};
+
+constexpr uint16_t LENGTH_BASE[]{3,  4,  5,  6,   7,   8,   9,   10,
+                                 11, 13, 15, 17,  19,  23,  27,  31,
+                                 35, 43, 51, 59,  67,  83,  99,  115,
+                                 131, 163, 195, 227, 258};
+constexpr uint8_t LENGTH_EXTRA[]{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t DISTANCE_BASE[]{
+    1,    2,    3,    4,    5,    7,     9,     13,    17,    25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513,   769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+constexpr uint8_t DISTANCE_EXTRA[]{0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                   4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                   9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+constexpr int LITERALS{286}, DISTANCES{30}, LENGTH_CODES{19};
+
+/// Order in which the lengths of the code length code are sent.
+constexpr uint8_t CODE_LENGTH_ORDER[]{16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                      11, 4,  12, 3, 13, 2, 14, 1, 15};
+
+/// Codes of match lengths and distances, minus their first code.
+struct Codes {
+    Codes() {
+        for (int n = MIN_MATCH, c = 0; n <= MAX_MATCH; ++n) {
+            if (c + 1 < 29 && n >= LENGTH_BASE[c + 1]) ++c;
+            length[n] = c;
+        }
+        for (size_t d = 1, c = 0; d <= WINDOW; ++d) {
+            if (c + 1 < 30 && d >= DISTANCE_BASE[c + 1]) ++c;
+            distance[d] = c;
+        }
+    }
+
+    array<uint8_t, MAX_MATCH + 1> length;
+    array<uint8_t, WINDOW + 1> distance;
+};
+
+const Codes &codes() {
+    static const Codes codes;
+    return codes;
+}
+
+/// CRC-32 of the chunks, four bytes at a time (slicing by 4).
+uint32_t crc32(uint32_t crc, const uint8_t *p, size_t n) {
+    static const auto table = []() {
+        array<array<uint32_t, 256>, 4> t;
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = c & 1 ? 0xedb88320 ^ c >> 1 : c >> 1;
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i)
+            for (int k = 1; k < 4; ++k)
+                t[k][i] = t[0][t[k - 1][i] & 0xff] ^ t[k - 1][i] >> 8;
+        return t;
+    }();
+
+    crc = ~crc;
+    for (; n >= 4; n -= 4, p += 4) {
+        crc ^= uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 |
+               uint32_t(p[3]) << 24;
+        crc = table[3][crc & 0xff] ^ table[2][crc >> 8 & 0xff] ^
+              table[1][crc >> 16 & 0xff] ^ table[0][crc >> 24];
+    }
+    for (; n; --n) crc = table[0][(crc ^ *p++) & 0xff] ^ crc >> 8;
+    return ~crc;
+}
+
+constexpr uint32_t ADLER_BASE{65521};
+
+uint32_t adler32(const uint8_t *p, size_t n) {
+    uint32_t a = 1, b = 0;
+    while (n) {
+        // the sums cannot overflow within 5552 bytes
+        auto k = min(n, size_t(5552));
+        n -= k;
+        for (; k; --k) {
+            a += *p++;
+            b += a;
+        }
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+    }
+    return b << 16 | a;
+}
+
+/// The Adler-32 of A followed by B, of length lengthB.
+uint32_t adler32Combine(uint32_t adlerA, uint32_t adlerB, size_t lengthB) {
+    uint32_t rem = lengthB % ADLER_BASE;
+    uint32_t a = adlerA & 0xffff;
+    uint32_t b = uint64_t(rem) * a % ADLER_BASE;
+    a += (adlerB & 0xffff) + ADLER_BASE - 1;
+    b += (adlerA >> 16) + (adlerB >> 16) + ADLER_BASE - rem;
+    if (a >= ADLER_BASE) a -= ADLER_BASE;
+    if (a >= ADLER_BASE) a -= ADLER_BASE;
+    if (b >= 2 * ADLER_BASE) b -= 2 * ADLER_BASE;
+    if (b >= ADLER_BASE) b -= ADLER_BASE;
+    return b << 16 | a;
+}
+
+void putBigEndian(Bytes &out, uint32_t v) {
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back(v >> shift);
+}
+
+/// A chunk of type, to be filled then closed.
+Bytes openChunk(const char *type) {
+    Bytes chunk(8, 0);
+    copy_n(type, 4, chunk.begin() + 4);
+    return chunk;
+}
+
+/// Write the length of the data and append the CRC.
+void closeChunk(Bytes &chunk) {
+    uint32_t length = chunk.size() - 8;
+    for (int i = 0; i < 4; ++i) chunk[i] = length >> (24 - 8 * i);
+    putBigEndian(chunk, crc32(0, chunk.data() + 4, chunk.size() - 4));
+}
+
+/// Deflate output, least significant bit first.
+class Bits {
+public:
+    explicit Bits(Bytes &out) : _out(out) {}
+
+    void put(uint32_t value, int count) {
+        _buffer |= uint64_t(value) << _count;
+        _count += count;
+        while (_count >= 8) {
+            _out.push_back(uint8_t(_buffer));
+            _buffer >>= 8;
+            _count -= 8;
+        }
+    }
+
+    /// Pad with zeros to a byte boundary.
+    void align() {
+        if (_count) put(0, 8 - _count);
+    }
+
+    /// Append bytes, on a byte boundary.
+    void bytes(const uint8_t *p, size_t n) {
+        _out.insert(_out.end(), p, p + n);
+    }
+
+private:
+    Bytes &_out;
+    uint64_t _buffer{0};
+    int _count{0};
+};
+
+/// A canonical Huffman code of at most limit bits for freq.
+class Huffman {
+public:
+    Huffman(Frequencies freq, int limit)
+        : _lengths(freq.size()), _codes(freq.size()) {
+        lengths(freq, limit);
+        canonical(limit);
+    }
+
+    int size() const { return _lengths.size(); }
+    int length(int symbol) const { return _lengths[symbol]; }
+
+    void put(Bits &bits, int symbol) const {
+        bits.put(_codes[symbol], _lengths[symbol]);
+    }
+
+    /// Bits taken by the symbols counted in freq.
+    uint64_t cost(const Frequencies &freq) const {
+        uint64_t bits = 0;
+        for (size_t s = 0; s < freq.size(); ++s)
+            bits += uint64_t(freq[s]) * _lengths[s];
+        return bits;
+    }
+
+private:
+    /// Huffman tree depths, flattening freq until they fit in limit.
+    void lengths(Frequencies &freq, int limit) {
+        for (;;) {
+            vector<int> symbols;
+            for (size_t s = 0; s < freq.size(); ++s)
+                if (freq[s]) symbols.push_back(s);
+
+            // a complete code needs two symbols
+            for (size_t s = 0; symbols.size() < 2; ++s) {
+                if (freq[s]) continue;
+                freq[s] = 1;
+                symbols.push_back(s);
+            }
+
+            stable_sort(symbols.begin(), symbols.end(),
+                        [&freq](int a, int b) { return freq[a] < freq[b]; });
+
+            // leaves, then inner nodes in the order they are made: both
+            // queues are sorted by weight
+            auto m = symbols.size();
+            vector<uint64_t> weight(2 * m - 1);
+            vector<size_t> parent(2 * m - 1);
+            for (size_t i = 0; i < m; ++i) weight[i] = freq[symbols[i]];
+
+            size_t leaf = 0, inner = m;
+            for (auto next = m; next < 2 * m - 1; ++next) {
+                for (int k = 0; k < 2; ++k) {
+                    auto lighter = leaf < m && (inner == next ||
+                                                weight[leaf] <= weight[inner])
+                                       ? leaf++
+                                       : inner++;
+                    weight[next] += weight[lighter];
+                    parent[lighter] = next;
+                }
+            }
+
+            vector<int> depth(2 * m - 1, 0);
+            int deepest = 0;
+            for (auto i = 2 * m - 1; i-- > 0;) {
+                if (i != 2 * m - 2) depth[i] = depth[parent[i]] + 1;
+                if (i < m) deepest = max(deepest, depth[i]);
+            }
+
+            if (deepest <= limit) {
+                fill(_lengths.begin(), _lengths.end(), 0);
+                for (size_t i = 0; i < m; ++i) _lengths[symbols[i]] = depth[i];
+                return;
+            }
+
+            for (auto &f : freq) f = (f + 1) / 2;
+        }
+    }
+
+    /// Codes from the lengths (RFC 1951, 3.2.2), reversed for Bits.
+    void canonical(int limit) {
+        vector<uint32_t> count(limit + 1, 0), next(limit + 1, 0);
+        for (auto l : _lengths) ++count[l];
+        count[0] = 0;
+
+        uint32_t code = 0;
+        for (int bits = 1; bits <= limit; ++bits) {
+            code = (code + count[bits - 1]) << 1;
+            next[bits] = code;
+        }
+
+        for (size_t s = 0; s < _lengths.size(); ++s) {
+            int l = _lengths[s];
+            if (!l) continue;
+
+            uint32_t c = next[l]++, reversed = 0;
+            for (int i = 0; i < l; ++i, c >>= 1)
+                reversed = reversed << 1 | (c & 1);
+            _codes[s] = reversed;
+        }
+    }
+
+    vector<uint8_t> _lengths;
+    vector<uint16_t> _codes;
+};
+
+/// A literal byte if distance is 0, else a match.
+struct Symbol {
+    uint16_t value;  //!< the byte, or the length of the match
+    uint16_t distance;
+};
+
+/// A code length symbol: a length, or a repeat (16, 17 or 18).
+struct Run {
+    uint8_t code;
+    uint8_t repeat;
+};
+
+/**
+ * Deflate of a stripe: blocks ending on a byte boundary, none of them
+ * final, so that stripes can be concatenated.
+ */
+class Deflater {
+public:
+    explicit Deflater(Level level)
+        : _level(level),
+          _chain(level == Level::BEST ? 256 : 4),
+          _head(size_t(1) << HASH_BITS),
+          _literals(LITERALS),
+          _distances(DISTANCES) {}
+
+    void deflate(const Bytes &in, Bytes &out) {
+        Bits bits(out);
+        if (_level == Level::STORE) {
+            stored(bits, in.data(), in.size());
+            return;
+        }
+
+        _in = in.data();
+        _size = in.size();
+        _blockStart = 0;
+        _covered = 0;
+        fill(_head.begin(), _head.end(), -1);
+        _prev.resize(_size);
+
+        if (_level == Level::BEST)
+            lazy(bits);
+        else
+            greedy(bits);
+        block(bits);
+
+        // an empty stored block: a byte boundary, as a zlib sync flush
+        bits.put(0, 3);
+        bits.align();
+        bits.put(0, 16);
+        bits.put(0xffff, 16);
+    }
+
+private:
+    /// Matches are found at once, and only short ones are indexed.
+    void greedy(Bits &bits) {
+        for (size_t i = 0; i < _size;) {
+            int distance = 0, length = longest(i, distance);
+            insert(i);
+            if (length) {
+                match(length, distance);
+                if (length <= 4)
+                    for (int k = 1; k < length; ++k) insert(i + k);
+                i += length;
+            } else {
+                literal(_in[i++]);
+            }
+
+            if (_symbols.size() >= BLOCK) block(bits);
+        }
+    }
+
+    /// A match is kept only if the one at the next byte is not longer.
+    void lazy(Bits &bits) {
+        int previous = 0, previousDistance = 0;
+        bool pending = false;  //!< the byte before i is not encoded yet
+
+        for (size_t i = 0; i < _size;) {
+            int distance = 0, length = longest(i, distance);
+            insert(i);
+            if (previous && length <= previous) {
+                match(previous, previousDistance);
+                auto end = i - 1 + previous;
+                for (++i; i < end; ++i) insert(i);
+                previous = 0;
+                pending = false;
+            } else {
+                if (pending) literal(_in[i - 1]);
+                previous = length;
+                previousDistance = distance;
+                pending = true;
+                ++i;
+            }
+
+            if (_symbols.size() >= BLOCK) block(bits);
+        }
+
+        if (pending) literal(_in[_size - 1]);
+    }
+
+    size_t hash(size_t i) const {
+        uint32_t v = _in[i] << 16 | _in[i + 1] << 8 | _in[i + 2];
+        return v * 2654435761u >> (32 - HASH_BITS);
+    }
+
+    void insert(size_t i) {
+        if (i + MIN_MATCH > _size) return;
+        auto &head = _head[hash(i)];
+        _prev[i] = head;
+        head = i;
+    }
+
+    /// The longest match at i, before i is inserted; 0 if none.
+    int longest(size_t i, int &distance) {
+        if (i + MIN_MATCH > _size) return 0;
+
+        int best = MIN_MATCH - 1, limit = min(size_t(MAX_MATCH), _size - i);
+        auto s = _in + i;
+        int chain = _chain;
+        for (auto j = _head[hash(i)]; j >= 0 && i - j <= WINDOW && chain--;
+             j = _prev[j]) {
+            auto t = _in + j;
+            if (t[best] != s[best]) continue;
+
+            // eight bytes at a time, then the bytes left
+            int n = 0;
+            for (uint64_t a, b; n + 8 <= limit; n += 8) {
+                memcpy(&a, t + n, 8);
+                memcpy(&b, s + n, 8);
+                if (a != b) break;
+            }
+            while (n < limit && t[n] == s[n]) ++n;
+            if (n > best) {
+                best = n;
+                distance = i - j;
+                if (n == limit) break;
+            }
+        }
+
+        return best >= MIN_MATCH ? best : 0;
+    }
+
+    void literal(uint8_t c) {
+        _symbols.push_back({c, 0});
+        ++_literals[c];
+        ++_covered;
+    }
+
+    void match(int length, int distance) {
+        _symbols.push_back({uint16_t(length), uint16_t(distance)});
+        ++_literals[257 + codes().length[length]];
+        ++_distances[codes().distance[distance]];
+        _covered += length;
+    }
+
+    /// Write the symbols so far as a block, dynamic or stored.
+    void block(Bits &bits) {
+        if (_symbols.empty()) return;
+
+        ++_literals[256];
+        Huffman literals(_literals, 15), distances(_distances, 15);
+
+        // the code lengths of both codes, run-length encoded
+        int nLiterals = LITERALS, nDistances = DISTANCES;
+        while (nLiterals > 257 && !literals.length(nLiterals - 1)) --nLiterals;
+        while (nDistances > 1 && !distances.length(nDistances - 1))
+            --nDistances;
+
+        vector<uint8_t> lengths;
+        for (int s = 0; s < nLiterals; ++s)
+            lengths.push_back(literals.length(s));
+        for (int s = 0; s < nDistances; ++s)
+            lengths.push_back(distances.length(s));
+
+        vector<Run> runs;
+        Frequencies runFreq(LENGTH_CODES, 0);
+        auto run = [&runs, &runFreq](int code, int repeat) {
+            runs.push_back({uint8_t(code), uint8_t(repeat)});
+            ++runFreq[code];
+        };
+        for (size_t i = 0; i < lengths.size();) {
+            auto l = lengths[i];
+            size_t n = 1;
+            while (i + n < lengths.size() && lengths[i + n] == l) ++n;
+
+            if (!l && n >= 3) {
+                n = min(n, size_t(138));
+                run(n >= 11 ? 18 : 17, n);
+            } else if (l && n >= 4) {
+                n = min(n, size_t(7));
+                run(l, 1);
+                run(16, n - 1);
+            } else {
+                n = 1;
+                run(l, 1);
+            }
+            i += n;
+        }
+
+        Huffman lengthCode(runFreq, 7);
+        int nCodes = LENGTH_CODES;
+        while (nCodes > 4 && !lengthCode.length(CODE_LENGTH_ORDER[nCodes - 1]))
+            --nCodes;
+
+        // the block in bits, against the same bytes stored
+        uint64_t cost = 3 + 5 + 5 + 4 + 3 * nCodes + lengthCode.cost(runFreq) +
+                        literals.cost(_literals) + distances.cost(_distances);
+        for (int c = 0; c < 29; ++c)
+            cost += uint64_t(_literals[257 + c]) * LENGTH_EXTRA[c];
+        for (int c = 0; c < DISTANCES; ++c)
+            cost += uint64_t(_distances[c]) * DISTANCE_EXTRA[c];
+        cost += runFreq[16] * 2 + runFreq[17] * 3 + runFreq[18] * 7;
+
+        auto raw = _covered - _blockStart;
+        if (cost > (raw + (raw / STORED + 1) * 5) * 8) {
+            stored(bits, _in + _blockStart, raw);
+        } else {
+            bits.put(0, 1);  // not final
+            bits.put(2, 2);  // dynamic Huffman codes
+            bits.put(nLiterals - 257, 5);
+            bits.put(nDistances - 1, 5);
+            bits.put(nCodes - 4, 4);
+            for (int i = 0; i < nCodes; ++i)
+                bits.put(lengthCode.length(CODE_LENGTH_ORDER[i]), 3);
+
+            for (const auto &r : runs) {
+                lengthCode.put(bits, r.code);
+                if (r.code == 16) bits.put(r.repeat - 3, 2);
+                if (r.code == 17) bits.put(r.repeat - 3, 3);
+                if (r.code == 18) bits.put(r.repeat - 11, 7);
+            }
+
+            for (const auto &s : _symbols) {
+                if (!s.distance) {
+                    literals.put(bits, s.value);
+                    continue;
+                }
+
+                int c = codes().length[s.value];
+                literals.put(bits, 257 + c);
+                bits.put(s.value - LENGTH_BASE[c], LENGTH_EXTRA[c]);
+                c = codes().distance[s.distance];
+                distances.put(bits, c);
+                bits.put(s.distance - DISTANCE_BASE[c], DISTANCE_EXTRA[c]);
+            }
+            literals.put(bits, 256);
+        }
+
+        _symbols.clear();
+        fill(_literals.begin(), _literals.end(), 0);
+        fill(_distances.begin(), _distances.end(), 0);
+        _blockStart = _covered;
+    }
+
+    /// Stored blocks of the n bytes at p, from a byte boundary.
+    static void stored(Bits &bits, const uint8_t *p, size_t n) {
+        do {
+            auto k = min(n, STORED);
+            bits.put(0, 3);  // not final, stored
+            bits.align();
+            bits.put(k, 16);
+            bits.put(~k & 0xffff, 16);
+            bits.bytes(p, k);
+            p += k;
+            n -= k;
+        } while (n);
+    }
+
+    Level _level;
+    int _chain;  //!< candidates tried for a match
+
+    const uint8_t *_in{nullptr};
+    size_t _size{0};
+    vector<int32_t> _head;  //!< last position of each hash
+    vector<int32_t> _prev;  //!< previous position with the same hash
+
+    vector<Symbol> _symbols;  //!< of the block
+    Frequencies _literals, _distances;
+    size_t _blockStart{0};  //!< first byte of the block
+    size_t _covered{0};     //!< bytes encoded by the symbols so far
+};
+
+int paeth(int a, int b, int c) {
+    int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+/// Filter row, after prior, with the filter of type into f.
+void filter(int type, const Bytes &row, const Bytes &prior, uint8_t *f) {
+    constexpr size_t left = BYTES_PER_PIXEL;
+    auto n = row.size();
+    auto x = row.data(), b = prior.data();
+    switch (type) {
+    case 0:
+        copy_n(x, n, f);
+        break;
+    case 1:
+        copy_n(x, left, f);
+        for (size_t i = left; i < n; ++i) f[i] = x[i] - x[i - left];
+        break;
+    case 2:
+        for (size_t i = 0; i < n; ++i) f[i] = x[i] - b[i];
+        break;
+    case 3:
+        for (size_t i = 0; i < left; ++i) f[i] = x[i] - b[i] / 2;
+        for (size_t i = left; i < n; ++i)
+            f[i] = x[i] - (x[i - left] + b[i]) / 2;
+        break;
+    case 4:
+        for (size_t i = 0; i < left; ++i) f[i] = x[i] - b[i];
+        for (size_t i = left; i < n; ++i)
+            f[i] = x[i] - paeth(x[i - left], b[i], b[i - left]);
+        break;
+    }
+}
+
+/**
+ * Filter row, after prior, into out: the type of filter then the bytes.
+ * STORE does not filter, FAST filters with Up and BEST tries every filter
+ * and keeps the one of least absolute sum.
+ */
+void filter(const Bytes &row, const Bytes &prior, Level level, Bytes &out,
+            Bytes &trial) {
+    auto n = row.size();
+    int best = level == Level::STORE ? 0 : 2;
+    if (level == Level::BEST) {
+        trial.resize(n);
+        uint64_t least = UINT64_MAX;
+        for (int type = 0; type < 5; ++type) {
+            filter(type, row, prior, trial.data());
+            uint64_t sum = 0;
+            for (auto v : trial) sum += abs(int(int8_t(v)));
+            if (sum < least) {
+                least = sum;
+                best = type;
+            }
+        }
+    }
+
+    out.push_back(best);
+    out.resize(out.size() + n);
+    filter(best, row, prior, out.data() + out.size() - n);
+}
+
+/// The compressed rows [top, bottom) of a picture, as an IDAT chunk.
+struct Stripe {
+    int top, bottom;
+    Bytes chunk;
+    uint32_t adler{1};
+    size_t length{0};  //!< of the filtered rows
+    bool done{false};
+};
+
+/// Filter the rows of stripe at level into filtered.
+void filterRows(const graphics::raster::Canvas &canvas, Level level,
+                const Stripe &stripe, Bytes &filtered) {
+    auto width = canvas.width();
+    Bytes row(size_t(width) * BYTES_PER_PIXEL), prior(row.size(), 0), trial;
+    filtered.clear();
+    filtered.reserve((row.size() + 1) * (stripe.bottom - stripe.top));
+
+    auto rgb = [&canvas, width](int y, Bytes &out) {
+        auto p = canvas.data() + size_t(y) * width;
+        for (int x = 0; x < width; ++x) {
+            out[3 * x] = p[x] >> 24;
+            out[3 * x + 1] = p[x] >> 16;
+            out[3 * x + 2] = p[x] >> 8;
+        }
+    };
+
+    if (stripe.top) rgb(stripe.top - 1, prior);
+    for (int y = stripe.top; y < stripe.bottom; ++y) {
+        rgb(y, row);
+        filter(row, prior, level, filtered, trial);
+        swap(row, prior);
+    }
+}
+
+/// Filtered rows deflated into an IDAT chunk, the first after a zlib header.
+Bytes deflateRows(const Bytes &filtered, Level level, Deflater &deflater,
+                  bool first) {
+    auto chunk = openChunk("IDAT");
+    if (first) {
+        // the zlib header: deflate with a 32K window, no dictionary
+        chunk.push_back(0x78);
+        chunk.push_back(level == Level::BEST
+                            ? 0xda
+                            : level == Level::FAST ? 0x5e : 0x01);
+    }
+    deflater.deflate(filtered, chunk);
+    closeChunk(chunk);
+    return chunk;
+}
+
+/**
+ * Encode stripe at level with deflater. BEST encodes it as FAST does too,
+ * with fast, and keeps the smaller: filters chosen row by row can break
+ * the matches between rows that Up keeps.
+ */
+void encode(const graphics::raster::Canvas &canvas, Level level,
+            Deflater &deflater, Deflater &fast, Stripe &stripe) {
+    Bytes filtered;
+    filterRows(canvas, level, stripe, filtered);
+    stripe.chunk = deflateRows(filtered, level, deflater, !stripe.top);
+
+    if (level == Level::BEST) {
+        Bytes up;
+        filterRows(canvas, Level::FAST, stripe, up);
+        auto chunk = deflateRows(up, level, fast, !stripe.top);
+        if (chunk.size() < stripe.chunk.size()) {
+            stripe.chunk.swap(chunk);
+            filtered.swap(up);
+        }
+    }
+
+    stripe.adler = adler32(filtered.data(), filtered.size());
+    stripe.length = filtered.size();
+}
+
+void write(ostream &out, const Bytes &bytes) {
+    out.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+}  // namespace
+
+Level level(const string &name) {
+    string lower(name);
+    transform(lower.begin(), lower.end(), lower.begin(),
+              [](unsigned char c) { return tolower(c); });
+
+    if (lower == "store") return Level::STORE;
+    if (lower == "fast") return Level::FAST;
+    if (lower == "best") return Level::BEST;
+    throw logic_error("Unknown PNG level " + name);
+}
+
+const char *name(Level level) {
+    switch (level) {
+    case Level::STORE:
+        return "store";
+    case Level::FAST:
+        return "fast";
+    case Level::BEST:
+        return "best";
+    }
+    return "";
+}
+
+ostream &write(ostream &out, const graphics::raster::Canvas &canvas,
+               Level level, unsigned threads) {
+    int width = canvas.width(), height = canvas.height();
+    if (width <= 0 || height <= 0) throw logic_error("Empty picture");
+
+    out.write(reinterpret_cast<const char *>(SIGNATURE), sizeof(SIGNATURE));
+    auto header = openChunk("IHDR");
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    // 8 bit RGB, deflate, adaptive filters, not interlaced
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    closeChunk(header);
+    write(out, header);
+
+    auto rowBytes = size_t(width) * BYTES_PER_PIXEL + 1;
+    int rows = max(size_t(1), STRIPE / rowBytes);
+    vector<Stripe> stripes;
+    for (int top = 0; top < height; top += rows)
+        stripes.push_back({top, min(height, top + rows)});
+
+    if (!threads) threads = max(1u, thread::hardware_concurrency());
+    threads = min(size_t(threads), stripes.size());
+
+    mutex m;
+    condition_variable finished;
+    atomic<size_t> next{0};
+    auto worker = [&]() {
+        Deflater deflater(level), fast(Level::FAST);
+        for (size_t i; (i = next++) < stripes.size();) {
+            encode(canvas, level, deflater, fast, stripes[i]);
+            lock_guard<mutex> lock(m);
+            stripes[i].done = true;
+            finished.notify_all();
+        }
+    };
+
+    vector<thread> workers;
+    for (unsigned i = 0; i < threads; ++i) workers.emplace_back(worker);
+
+    // stripes are written, and freed, in order as soon as they are done
+    uint32_t adler = 1;
+    for (auto &stripe : stripes) {
+        {
+            unique_lock<mutex> lock(m);
+            finished.wait(lock, [&stripe]() { return stripe.done; });
+        }
+        write(out, stripe.chunk);
+        Bytes().swap(stripe.chunk);
+        adler = adler32Combine(adler, stripe.adler, stripe.length);
+    }
+    for (auto &w : workers) w.join();
+
+    // a final empty block with fixed codes, and the checksum
+    auto end = openChunk("IDAT");
+    end.push_back(0x03);
+    end.push_back(0x00);
+    putBigEndian(end, adler);
+    closeChunk(end);
+    write(out, end);
+
+    auto trailer = openChunk("IEND");
+    closeChunk(trailer);
+    write(out, trailer);
+    return out;
+}
+
+} /* ns: png */
+
+} /* ns: mlogo */
@@ -0,0 +1,53 @@
+/**
+ * @file: png.hpp
+ *
+ * PNG encoder for canvases, with its own deflate.
+ *
+ * The image is cut into stripes of rows, which workers filter and deflate
+ * independently, as pigz does: each stripe is a run of deflate blocks that
+ * ends on a byte boundary, so the stripes are concatenated as they are,
+ * one IDAT chunk each, and their Adler-32 checksums are combined. The
+ * picture is written as 8 bit RGB; the alpha of the canvas is dropped.
+ */
+
+#ifndef __PNG_HPP__
+#define __PNG_HPP__
+
+#include <iostream>
+#include <string>
+
+namespace mlogo {
+
+namespace graphics {
+namespace raster {
+class Canvas;
+}
+}
+
+namespace png {
+
+/**
+ * STORE does not compress; FAST takes the first match it finds and
+ * filters every row with Up; BEST searches longer, defers matches by one
+ * byte when the next one is longer and chooses the filter of each row,
+ * but keeps a stripe as FAST encodes it when that is smaller, so that it
+ * is never larger than FAST.
+ */
+enum class Level { STORE, FAST, BEST };
+
+/// @throw std::logic_error unless name is "store", "fast" or "best".
+Level level(const std::string &name);
+const char *name(Level level);
+
+/**
+ * Write canvas to out as PNG, with threads workers (one per core if 0).
+ * @throw std::logic_error if the canvas is empty.
+ */
+std::ostream &write(std::ostream &out, const graphics::raster::Canvas &canvas,
+                    Level level = Level::FAST, unsigned threads = 0);
+
+} /* ns: png */
+
+} /* ns: mlogo */
+
+#endif /* __PNG_HPP__ */
@@ -0,0 +1,212 @@
+/**
+ * @file: profiler.cpp
+ * Implements profiler.hpp
+ */
+
+#include "profiler.hpp"
+
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/algorithm/string.hpp>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+using namespace std;
+
+namespace mlogo {
+
+namespace profiler {
+
+namespace {
+
+/// Name of the samples taken outside any procedure.
+const char TOPLEVEL[]{"(toplevel)"};
+
+struct sigaction previousAction;
+
+/// The frequency in MLOGO_PROFILE_HZ, or the default if it is not positive.
+unsigned frequencyFromEnv() {
+    auto hz = getenv("MLOGO_PROFILE_HZ");
+    if (!hz || !*hz) return Sampler::DEFAULT_FREQUENCY;
+
+    char *end;
+    errno = 0;
+    long frequency = strtol(hz, &end, 10);
+    if (errno || *end || frequency <= 0 || frequency > 1000000000L) {
+        cerr << "Ignoring MLOGO_PROFILE_HZ=" << hz
+             << ": expected a positive number of samples per second" << endl;
+        return Sampler::DEFAULT_FREQUENCY;
+    }
+
+    return unsigned(frequency);
+}
+
+}  // namespace
+
+Sampler::Sampler() {
+    auto filename = getenv("MLOGO_PROFILE");
+    if (filename && *filename) {
+        start(filename, frequencyFromEnv());
+    }
+}
+
+Sampler::~Sampler() {
+    if (active()) stop();
+}
+
+void Sampler::start(const string &filename, unsigned frequency) {
+    if (active()) stop();
+    if (frequency == 0) frequency = DEFAULT_FREQUENCY;
+
+    if (_ring.empty()) _ring.resize(CAPACITY);
+    _filename = filename;
+
+    struct sigaction action;
+    action.sa_handler = &Sampler::onSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, &previousAction);
+
+    sigevent event{};
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = syscall(SYS_gettid);
+
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &_timer) != 0) {
+        sigaction(SIGPROF, &previousAction, nullptr);
+        throw logic_error("Cannot create the profiler timer.");
+    }
+    _hasTimer = true;
+
+    long period = 1000000000L / frequency;
+    itimerspec spec{};
+    spec.it_interval.tv_sec = period / 1000000000L;
+    spec.it_interval.tv_nsec = period % 1000000000L;
+    spec.it_value = spec.it_interval;
+
+    _active = true;
+    timer_settime(_timer, 0, &spec, nullptr);
+}
+
+void Sampler::stop() {
+    _active = false;
+
+    if (_hasTimer) {
+        timer_delete(_timer);
+        sigaction(SIGPROF, &previousAction, nullptr);
+        _hasTimer = false;
+    }
+
+    drain();
+    if (!_filename.empty()) write();
+}
+
+void Sampler::enter(const string &name) {
+    auto depth = _depth.load(memory_order_relaxed);
+    if (depth < MAX_DEPTH) _stack[depth] = intern(name);
+
+    // the handler runs on this thread: order the store before the push
+    atomic_signal_fence(memory_order_release);
+    _depth.store(depth + 1, memory_order_relaxed);
+
+    if (_head.load(memory_order_acquire) - _tail.load(memory_order_relaxed) >
+        CAPACITY / 2) {
+        drain();
+    }
+}
+
+void Sampler::leave() {
+    auto depth = _depth.load(memory_order_relaxed);
+    if (depth > 0) _depth.store(depth - 1, memory_order_relaxed);
+}
+
+void Sampler::sample() {
+    auto head = _head.load(memory_order_relaxed);
+    if (_ring.empty() ||
+        head - _tail.load(memory_order_acquire) >= _ring.size()) {
+        _dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    auto &slot = _ring[head % _ring.size()];
+    uint32_t depth = _depth.load(memory_order_relaxed);
+    atomic_signal_fence(memory_order_acquire);
+
+    slot.depth = depth;
+    for (uint32_t i = 0; i < depth && i < MAX_DEPTH; ++i)
+        slot.frames[i] = _stack[i];
+
+    _head.store(head + 1, memory_order_release);
+}
+
+const Sampler::FoldedStacks &Sampler::folded() {
+    drain();
+    return _folded;
+}
+
+void Sampler::reset() {
+    if (_ring.empty()) _ring.resize(CAPACITY);
+
+    drain();
+    _folded.clear();
+    _dropped = 0;
+}
+
+void Sampler::onSignal(int) {
+    int savedErrno = errno;
+    Sampler::instance().sample();
+    errno = savedErrno;
+}
+
+uint32_t Sampler::intern(const string &name) {
+    auto iter = _ids.find(name);
+    if (iter != _ids.end()) return iter->second;
+
+    uint32_t id = _names.size();
+    _names.push_back(boost::to_lower_copy(name));
+    _ids.emplace(name, id);
+
+    return id;
+}
+
+void Sampler::drain() {
+    auto head = _head.load(memory_order_acquire);
+    auto tail = _tail.load(memory_order_relaxed);
+
+    for (; tail != head; ++tail) {
+        auto &slot = _ring[tail % _ring.size()];
+
+        stringstream ss;
+        if (slot.depth == 0) ss << TOPLEVEL;
+        for (uint32_t i = 0; i < slot.depth && i < MAX_DEPTH; ++i) {
+            if (i) ss << ";";
+            ss << _names[slot.frames[i]];
+        }
+        if (slot.depth > MAX_DEPTH) ss << ";...";
+
+        ++_folded[ss.str()];
+    }
+
+    _tail.store(tail, memory_order_release);
+}
+
+void Sampler::write() const {
+    ofstream out(_filename);
+    for (auto &stack : _folded)
+        out << stack.first << " " << stack.second << endl;
+}
+
+} /* ns: profiler */
+
+} /* ns: mlogo */
@@ -0,0 +1,151 @@
+/**
+ * @file: profiler.hpp
+ *
+ * Sampling profiler of the Logo call stack.
+ *
+ * Every procedure call pushes its name on a small fixed-size stack of
+ * interned ids. A SIGPROF timer, driven by the CPU time of the
+ * interpreter thread, copies that stack into a lock-free ring buffer
+ * from the signal handler. The interpreter thread drains the ring into a
+ * table of folded stacks ("a;b;c count") suitable for flamegraph.pl or
+ * speedscope.
+ *
+ * Sampling is turned on by setting MLOGO_PROFILE to the output file
+ * (and optionally MLOGO_PROFILE_HZ to the frequency), or at runtime with
+ * PROFILE.START and PROFILE.STOP.
+ */
+
+#ifndef __PROFILER_HPP__
+#define __PROFILER_HPP__
+
+#include <time.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mlogo {
+
+namespace profiler {
+
+class Sampler {
+public:
+    static constexpr std::size_t MAX_DEPTH{48};
+    static constexpr std::size_t CAPACITY{2048};
+    static constexpr unsigned DEFAULT_FREQUENCY{997};
+
+    using FoldedStacks = std::map<std::string, std::size_t>;
+
+    static Sampler &instance() {
+        static Sampler _instance;
+        return _instance;
+    }
+
+    /**
+     * Start sampling the current thread.
+     *
+     * @param[in] filename where folded stacks are written by stop().
+     * @param[in] frequency samples per second of CPU time.
+     * @throw std::logic_error if the timer cannot be created.
+     */
+    void start(const std::string &filename,
+               unsigned frequency = DEFAULT_FREQUENCY);
+
+    /// Stop the timer and write the folded stacks collected so far.
+    void stop();
+
+    bool active() const { return _active.load(std::memory_order_relaxed); }
+
+    /// Push a procedure on the sampled call stack.
+    void enter(const std::string &name);
+
+    /// Pop the last procedure from the sampled call stack.
+    void leave();
+
+    /// Record the current call stack. This is what the signal handler does.
+    void sample();
+
+    /// Drain pending samples and return the aggregated folded stacks.
+    const FoldedStacks &folded();
+
+    /// Number of samples lost because the ring buffer was full.
+    uint64_t dropped() const { return _dropped.load(); }
+
+    /// Forget every collected sample and get the ring buffer ready.
+    void reset();
+
+private:
+    struct Sample {
+        uint32_t depth;
+        uint32_t frames[MAX_DEPTH];
+    };
+
+    Sampler();
+    ~Sampler();
+
+    Sampler(const Sampler &) = delete;
+    Sampler(Sampler &&) = delete;
+
+    Sampler &operator=(const Sampler &) = delete;
+    Sampler &operator=(Sampler &&) = delete;
+
+    static void onSignal(int);
+
+    uint32_t intern(const std::string &name);
+    void drain();
+    void write() const;
+
+    std::atomic<bool> _active{false};
+
+    // Call stack: written by the interpreter thread, read by the handler.
+    uint32_t _stack[MAX_DEPTH];
+    std::atomic<uint32_t> _depth{0};
+
+    // Ring: the handler is the producer, the interpreter the consumer.
+    std::vector<Sample> _ring;
+    std::atomic<std::size_t> _head{0};
+    std::atomic<std::size_t> _tail{0};
+    std::atomic<uint64_t> _dropped{0};
+
+    std::vector<std::string> _names;
+    std::unordered_map<std::string, uint32_t> _ids;
+    FoldedStacks _folded;
+
+    std::string _filename;
+    timer_t _timer{};
+    bool _hasTimer{false};
+};
+
+/**
+ * Keep a procedure on the sampled call stack for the lifetime of this
+ * object. It does nothing while the sampler is off.
+ */
+class Frame {
+public:
+    explicit Frame(const std::string &name) {
+        auto &sampler = Sampler::instance();
+        if (sampler.active()) {
+            sampler.enter(name);
+            _entered = true;
+        }
+    }
+
+    ~Frame() {
+        if (_entered) Sampler::instance().leave();
+    }
+
+private:
+    Frame(const Frame &) = delete;
+    Frame &operator=(const Frame &) = delete;
+
+    bool _entered{false};
+};
+
+} /* ns: profiler */
+
+} /* ns: mlogo */
+
+#endif /* __PROFILER_HPP__ */
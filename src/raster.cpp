@@ -0,0 +1,592 @@
+/**
+ * @file: raster.cpp
+ * Implements raster.hpp
+ */
+
+#include "raster.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "png.hpp"
+#include "stats.hpp"
+
+using namespace std;
+
+namespace mlogo {
+
+namespace graphics {
+
+namespace raster {
+
+Canvas::Canvas(int width, int height)
+    : _width(width), _height(height), _pixels(size_t(width) * height) {}
+
+void Canvas::fill(const Color &c) {
+    auto p = pack(c);
+    for (auto &pixel : _pixels) pixel = p;
+}
+
+void Canvas::fill(const Spans &spans, const Color &c) {
+    auto p = pack(c);
+    for (const auto &span : spans)
+        fill_n(_pixels.begin() + size_t(span.y) * _width + span.x0,
+               span.x1 - span.x0 + 1, p);
+}
+
+void Canvas::pixel(int x, int y, const Color &c) {
+    if (inside(x, y)) _pixels[size_t(y) * _width + x] = pack(c);
+}
+
+Color Canvas::pixel(int x, int y) const {
+    if (!inside(x, y)) return Color(0, 0, 0, 0);
+    return unpack(_pixels[size_t(y) * _width + x]);
+}
+
+namespace {
+
+/// The steps i in [0, d] of a0 + s * i that fall in [0, n).
+pair<int64_t, int64_t> stepsInside(int a0, int s, int64_t d, int n) {
+    int64_t first = s > 0 ? -a0 : a0 - (n - 1);
+    int64_t last = s > 0 ? n - 1 - a0 : a0;
+    return {max<int64_t>(first, 0), min(last, d)};
+}
+
+}  // namespace
+
+void Canvas::line(int x0, int y0, int x1, int y1, const Color &c) {
+    // Bresenham in closed form: at step i along the major axis the minor
+    // one has moved by (2 i dMinor + dMajor) / (2 dMajor), so the steps off
+    // the canvas are skipped, and a tile of a larger image gets the very
+    // pixels of the whole line
+    auto p = pack(c);
+    int64_t dx = abs(x1 - x0), dy = abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+
+    if (dx >= dy) {
+        auto steps = stepsInside(x0, sx, dx, _width);
+        for (auto i = steps.first; i <= steps.second; ++i) {
+            int y = y0 + sy * (dx ? (2 * i * dy + dx) / (2 * dx) : 0);
+            if (y >= 0 && y < _height)
+                _pixels[size_t(y) * _width + x0 + sx * i] = p;
+        }
+    } else {
+        auto steps = stepsInside(y0, sy, dy, _height);
+        for (auto i = steps.first; i <= steps.second; ++i) {
+            int x = x0 + sx * ((2 * i * dx + dy) / (2 * dy));
+            if (x >= 0 && x < _width)
+                _pixels[size_t(y0 + sy * i) * _width + x] = p;
+        }
+    }
+}
+
+namespace {
+
+/// A segment a..b with a coverage falling to 0 at reach from it.
+struct Capsule {
+    float ax, ay, dx, dy;
+    float invLength2;  //!< 1 / |b - a|^2, 0 if a is b
+    float reach;       //!< half the width, plus half a pixel
+};
+
+/// Blended channels: r, g, b, and alpha towards opaque.
+struct Source {
+    float r, g, b, a;
+    float alpha;  //!< of the color, in [0, 1]
+};
+
+/// Pixels blendVector() takes at a time.
+#if defined(__AVX2__)
+constexpr int LANES{8};
+#elif defined(__SSE2__)
+constexpr int LANES{4};
+#else
+constexpr int LANES{1};
+#endif
+
+/**
+ * Blend pixels [x, end) of row, centered on y, one at a time. The row
+ * starts at column left of the image the capsule is in.
+ */
+void blendScalar(Canvas::Pixel *row, int x, int end, int left, float y,
+                 const Capsule &c, const Source &s) {
+    for (; x < end; ++x) {
+        float qx = (float(x + left) + 0.5f) - c.ax, qy = y - c.ay;
+        float t = (qx * c.dx + qy * c.dy) * c.invLength2;
+        t = min(max(t, 0.0f), 1.0f);
+        float ex = qx - t * c.dx, ey = qy - t * c.dy;
+        float d = sqrt(ex * ex + ey * ey);
+        float a = min(max(c.reach - d, 0.0f), 1.0f) * s.alpha;
+
+        auto p = row[x];
+        float pr = p >> 24, pg = (p >> 16) & 0xff, pb = (p >> 8) & 0xff,
+              pa = p & 0xff;
+        row[x] = Canvas::Pixel(lrint(pr + (s.r - pr) * a)) << 24 |
+                 Canvas::Pixel(lrint(pg + (s.g - pg) * a)) << 16 |
+                 Canvas::Pixel(lrint(pb + (s.b - pb) * a)) << 8 |
+                 Canvas::Pixel(lrint(pa + (s.a - pa) * a));
+    }
+}
+
+/// blendScalar(), several pixels at a time; the same float arithmetic.
+void blendVector(Canvas::Pixel *row, int x, int end, int left, float y,
+                 const Capsule &c, const Source &s) {
+#if defined(__AVX2__)
+    auto ax = _mm256_set1_ps(c.ax), dx = _mm256_set1_ps(c.dx),
+         dy = _mm256_set1_ps(c.dy), il = _mm256_set1_ps(c.invLength2),
+         reach = _mm256_set1_ps(c.reach), alpha = _mm256_set1_ps(s.alpha);
+    auto zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1);
+    auto sr = _mm256_set1_ps(s.r), sg = _mm256_set1_ps(s.g),
+         sb = _mm256_set1_ps(s.b), sa = _mm256_set1_ps(s.a);
+    auto mask = _mm256_set1_epi32(0xff);
+    auto lanes = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f,
+                                7.5f);
+    auto qy = _mm256_set1_ps(y - c.ay);
+    auto qyDy = _mm256_mul_ps(qy, dy);
+
+    for (; x + 8 <= end; x += 8) {
+        auto qx = _mm256_sub_ps(
+            _mm256_add_ps(_mm256_set1_ps(float(x + left)), lanes), ax);
+        auto t = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(qx, dx), qyDy), il);
+        t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+        auto ex = _mm256_sub_ps(qx, _mm256_mul_ps(t, dx));
+        auto ey = _mm256_sub_ps(qy, _mm256_mul_ps(t, dy));
+        auto d = _mm256_sqrt_ps(
+            _mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey)));
+        auto a = _mm256_mul_ps(
+            _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(reach, d), zero), one),
+            alpha);
+
+        auto p = _mm256_loadu_si256(reinterpret_cast<__m256i *>(row + x));
+        auto blend = [&a](__m256i channel, __m256 source) {
+            auto v = _mm256_cvtepi32_ps(channel);
+            return _mm256_cvtps_epi32(
+                _mm256_add_ps(v, _mm256_mul_ps(_mm256_sub_ps(source, v), a)));
+        };
+        auto r = blend(_mm256_srli_epi32(p, 24), sr);
+        auto g = blend(_mm256_and_si256(_mm256_srli_epi32(p, 16), mask), sg);
+        auto b = blend(_mm256_and_si256(_mm256_srli_epi32(p, 8), mask), sb);
+        auto al = blend(_mm256_and_si256(p, mask), sa);
+        p = _mm256_or_si256(
+            _mm256_or_si256(_mm256_slli_epi32(r, 24), _mm256_slli_epi32(g, 16)),
+            _mm256_or_si256(_mm256_slli_epi32(b, 8), al));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + x), p);
+    }
+#elif defined(__SSE2__)
+    auto ax = _mm_set1_ps(c.ax), dx = _mm_set1_ps(c.dx),
+         dy = _mm_set1_ps(c.dy), il = _mm_set1_ps(c.invLength2),
+         reach = _mm_set1_ps(c.reach), alpha = _mm_set1_ps(s.alpha);
+    auto zero = _mm_setzero_ps(), one = _mm_set1_ps(1);
+    auto sr = _mm_set1_ps(s.r), sg = _mm_set1_ps(s.g), sb = _mm_set1_ps(s.b),
+         sa = _mm_set1_ps(s.a);
+    auto mask = _mm_set1_epi32(0xff);
+    auto lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    auto qy = _mm_set1_ps(y - c.ay);
+    auto qyDy = _mm_mul_ps(qy, dy);
+
+    for (; x + 4 <= end; x += 4) {
+        auto qx =
+            _mm_sub_ps(_mm_add_ps(_mm_set1_ps(float(x + left)), lanes), ax);
+        auto t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(qx, dx), qyDy), il);
+        t = _mm_min_ps(_mm_max_ps(t, zero), one);
+        auto ex = _mm_sub_ps(qx, _mm_mul_ps(t, dx));
+        auto ey = _mm_sub_ps(qy, _mm_mul_ps(t, dy));
+        auto d =
+            _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)));
+        auto a = _mm_mul_ps(
+            _mm_min_ps(_mm_max_ps(_mm_sub_ps(reach, d), zero), one), alpha);
+
+        auto p = _mm_loadu_si128(reinterpret_cast<__m128i *>(row + x));
+        auto blend = [&a](__m128i channel, __m128 source) {
+            auto v = _mm_cvtepi32_ps(channel);
+            return _mm_cvtps_epi32(
+                _mm_add_ps(v, _mm_mul_ps(_mm_sub_ps(source, v), a)));
+        };
+        auto r = blend(_mm_srli_epi32(p, 24), sr);
+        auto g = blend(_mm_and_si128(_mm_srli_epi32(p, 16), mask), sg);
+        auto b = blend(_mm_and_si128(_mm_srli_epi32(p, 8), mask), sb);
+        auto al = blend(_mm_and_si128(p, mask), sa);
+        p = _mm_or_si128(
+            _mm_or_si128(_mm_slli_epi32(r, 24), _mm_slli_epi32(g, 16)),
+            _mm_or_si128(_mm_slli_epi32(b, 8), al));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row + x), p);
+    }
+#endif
+
+    blendScalar(row, x, end, left, y, c, s);
+}
+
+}  // namespace
+
+void Canvas::smoothLine(double x0, double y0, double x1, double y1,
+                        double width, const Color &c, int left, int top) {
+    smoothLine(x0, y0, x1, y1, width, c, left, top, true);
+}
+
+void Canvas::smoothLineScalar(double x0, double y0, double x1, double y1,
+                              double width, const Color &c, int left,
+                              int top) {
+    smoothLine(x0, y0, x1, y1, width, c, left, top, false);
+}
+
+void Canvas::smoothLine(double x0, double y0, double x1, double y1,
+                        double width, const Color &c, int left, int top,
+                        bool vector) {
+    if (!c.a || width <= 0) return;
+
+    double dx = x1 - x0, dy = y1 - y0, length2 = dx * dx + dy * dy;
+    Capsule capsule{float(x0), float(y0), float(dx), float(dy),
+                    length2 ? float(1 / length2) : 0.0f,
+                    float(width / 2 + 0.5)};
+    Source source{float(c.r), float(c.g), float(c.b), 255.0f,
+                  c.a / 255.0f};
+    double reach = capsule.reach, length = sqrt(length2);
+
+    // only the part of the segment within reach of the canvas covers it:
+    // bounds are taken from that part, so that far off ends fit an int
+    double right = left + _width, bottom = top + _height;
+    geometry::Box box{left - reach, top - reach, right + reach,
+                      bottom + reach};
+    geometry::Point a(x0, y0), b(x1, y1);
+    double t0, t1;
+    if (!box.clip(a, b, t0, t1)) return;
+    auto p0 = a + (b - a) * t0, p1 = a + (b - a) * t1;
+
+    // rows and columns of the image the reach may cover
+    int first = max(double(top), floor(min(p0.y, p1.y) - reach));
+    int last = min(bottom - 1, floor(max(p0.y, p1.y) + reach));
+    double xMin = min(p0.x, p1.x) - reach, xMax = max(p0.x, p1.x) + reach;
+
+    for (int y = first; y <= last; ++y) {
+        double center = y + 0.5, lo = xMin, hi = xMax;
+
+        // within reach of the line through the segment
+        if (dy) {
+            double x = x0 + (center - y0) * dx / dy;
+            double half = reach * length / abs(dy);
+            lo = max(lo, x - half);
+            hi = min(hi, x + half);
+        }
+
+        // columns of the canvas
+        double begin = max(0.0, ceil(lo - 0.5) - left);
+        double end = min(double(_width), floor(hi - 0.5) + 1 - left);
+        if (begin >= end) continue;
+        int from = begin, to = end;
+
+        auto row = _pixels.data() + size_t(y - top) * _width;
+        if (vector) {
+            // whole vectors: pixels out of reach blend to themselves
+            to = min(_width, from + (to - from + LANES - 1) / LANES * LANES);
+            blendVector(row, from, to, left, float(center), capsule, source);
+        } else {
+            blendScalar(row, from, to, left, float(center), capsule, source);
+        }
+    }
+}
+
+ostream &Canvas::writePPM(ostream &s) const {
+    writePPMHeader(s, _width, _height);
+    return writePPMPixels(s, _pixels.data(), _pixels.size());
+}
+
+ostream &writePPMHeader(ostream &s, int width, int height) {
+    return s << "P6\n" << width << " " << height << "\n255\n";
+}
+
+ostream &writePPMPixels(ostream &s, const Canvas::Pixel *pixels, size_t n) {
+    // converted in chunks, written with one call each
+    char rgb[3 * 1024];
+    while (n) {
+        auto chunk = min(n, sizeof(rgb) / 3);
+        for (size_t i = 0; i < chunk; ++i) {
+            auto p = pixels[i];
+            rgb[3 * i] = char(p >> 24);
+            rgb[3 * i + 1] = char(p >> 16);
+            rgb[3 * i + 2] = char(p >> 8);
+        }
+
+        s.write(rgb, 3 * chunk);
+        pixels += chunk;
+        n -= chunk;
+    }
+
+    return s;
+}
+
+void floodSpans(const Canvas &canvas, int x, int y, Spans &out) {
+    out.clear();
+    int width = canvas.width(), height = canvas.height();
+    if (x < 0 || y < 0 || x >= width || y >= height) return;
+
+    auto pixels = canvas.data();
+    auto target = pixels[size_t(y) * width + x];
+
+    // all clear between calls: only the spans found are marked, then cleared
+    thread_local allocation::Vector<uint8_t, allocation::Subsystem::GRAPHICS>
+        seen;
+    if (seen.size() < size_t(width) * height)
+        seen.resize(size_t(width) * height);
+    auto fillable = [&](int x, int y) {
+        auto i = size_t(y) * width + x;
+        return !seen[i] && pixels[i] == target;
+    };
+
+    struct Seed {
+        int x, y;
+    };
+    allocation::Vector<Seed, allocation::Subsystem::GRAPHICS> seeds{{x, y}};
+    while (!seeds.empty()) {
+        auto seed = seeds.back();
+        seeds.pop_back();
+        if (!fillable(seed.x, seed.y)) continue;
+
+        Span span{seed.x, seed.x, seed.y};
+        while (span.x0 > 0 && fillable(span.x0 - 1, span.y)) --span.x0;
+        while (span.x1 < width - 1 && fillable(span.x1 + 1, span.y))
+            ++span.x1;
+        fill_n(seen.begin() + size_t(span.y) * width + span.x0,
+               span.x1 - span.x0 + 1, 1);
+        out.push_back(span);
+
+        // one seed for each run of fillable pixels above and below
+        for (int row : {span.y - 1, span.y + 1}) {
+            if (row < 0 || row >= height) continue;
+
+            bool run{false};
+            for (int i = span.x0; i <= span.x1; ++i) {
+                bool f = fillable(i, row);
+                if (f && !run) seeds.push_back({i, row});
+                run = f;
+            }
+        }
+    }
+
+    for (const auto &span : out)
+        fill_n(seen.begin() + size_t(span.y) * width + span.x0,
+               span.x1 - span.x0 + 1, 0);
+}
+
+void polygonSpans(const geometry::Path &polygon, int width, int height,
+                  Spans &out, int left, int top) {
+    out.clear();
+
+    struct Edge {
+        double top, bottom;  //!< top < bottom, as y grows downwards
+        double x, slope;     //!< x at top, dx / dy
+    };
+    vector<Edge> edges;
+    edges.reserve(polygon.size());
+
+    auto first = polygon.begin()->toGPS(), a = first;
+    for (auto iter = polygon.begin(); iter != polygon.end(); ++iter) {
+        auto b = iter + 1 == polygon.end() ? first : (iter + 1)->toGPS();
+        if (a.y != b.y) {
+            auto &t = a.y < b.y ? a : b, &u = a.y < b.y ? b : a;
+            edges.push_back({t.y, u.y, t.x, (u.x - t.x) / (u.y - t.y)});
+        }
+        a = b;
+    }
+    if (edges.empty()) return;
+
+    sort(edges.begin(), edges.end(),
+         [](const Edge &a, const Edge &b) { return a.top < b.top; });
+    double bottom{edges.front().bottom};
+    for (const auto &e : edges) bottom = max(bottom, e.bottom);
+
+    // rows whose center may be inside
+    int y0 = max(double(top), floor(edges.front().top));
+    int y1 = min(double(top + height), ceil(bottom));
+
+    vector<Edge> active;
+    vector<double> xs;
+    size_t next{0};
+    for (int y = y0; y < y1; ++y) {
+        double center = y + 0.5;
+
+        // an edge covers the rows with centers in [top, bottom)
+        while (next < edges.size() && edges[next].top <= center)
+            active.push_back(edges[next++]);
+        active.erase(remove_if(active.begin(), active.end(),
+                               [center](const Edge &e) {
+                                   return e.bottom <= center;
+                               }),
+                     active.end());
+
+        xs.clear();
+        for (const auto &e : active)
+            xs.push_back(e.x + (center - e.top) * e.slope);
+        sort(xs.begin(), xs.end());
+
+        // pixels with centers in [xs[i], xs[i + 1])
+        for (size_t i = 0; i + 1 < xs.size(); i += 2) {
+            int x0 = max(double(left), ceil(xs[i] - 0.5));
+            int x1 = min(double(left + width), ceil(xs[i + 1] - 0.5)) - 1;
+            if (x0 <= x1) out.push_back({x0 - left, x1 - left, y - top});
+        }
+    }
+}
+
+} /* ns: raster */
+
+HeadlessWindow::HeadlessWindow(int width, int height)
+    : _canvas(width, height), _width(width), _height(height) {
+    clear();
+}
+
+HeadlessWindow::~HeadlessWindow() {
+    if (_snapshot.empty()) return;
+
+    ofstream out(_snapshot, ios::binary);
+    if (!out) return;
+
+    auto png = _snapshot.size() > 4 &&
+               _snapshot.compare(_snapshot.size() - 4, 4, ".png") == 0;
+    if (png)
+        png::write(out, frame());
+    else
+        frame().writePPM(out);
+}
+
+Window *HeadlessWindow::background(const Color &color) {
+    _background = color;
+    return this;
+}
+
+Window *HeadlessWindow::foreground(const Color &color) {
+    _foreground = color;
+    return this;
+}
+
+Window *HeadlessWindow::clear() {
+    _canvas.fill(_background);
+    _color = _foreground;
+    return this;
+}
+
+Window *HeadlessWindow::draw(const geometry::Path &path, size_t first) {
+    auto segments = stroke(_canvas, path, first);
+    if (segments) stats::count(stats::Counter::SEGMENTS, segments);
+    return this;
+}
+
+Window *HeadlessWindow::sprites(const geometry::Scene &sprites) {
+    _sprites = sprites;
+    _showSprite = true;
+    return this;
+}
+
+Window *HeadlessWindow::hideSprite() {
+    _showSprite = false;
+    return this;
+}
+
+Window *HeadlessWindow::setColor(const Color &c) {
+    _color = c;
+    return this;
+}
+
+void HeadlessWindow::tile(int left, int top, int width, int height) {
+    _left = left;
+    _top = top;
+    _width = width;
+    _height = height;
+}
+
+Window *HeadlessWindow::fill(const geometry::Point &seed) {
+    auto p = seed.toGPS();
+    raster::floodSpans(_canvas, floor(p.x) - _left, floor(p.y) - _top,
+                       _spans);
+    _canvas.fill(_spans, _color);
+    return this;
+}
+
+Window *HeadlessWindow::fillPolygon(const geometry::Path &polygon,
+                                    const Color &c) {
+    raster::polygonSpans(polygon, _canvas.width(), _canvas.height(), _spans,
+                         _left, _top);
+    _canvas.fill(_spans, c);
+    return this;
+}
+
+Window *HeadlessWindow::paint() {
+    stats::count(stats::Counter::PRESENTS);
+    return this;
+}
+
+raster::Canvas HeadlessWindow::frame() const {
+    auto out = _canvas;
+    if (!_showSprite) return out;
+
+    for (size_t k = 0; k < _sprites.paths(); ++k)
+        stroke(out, _sprites.path(k, _sprites.pathStart(k)), 0);
+    return out;
+}
+
+size_t HeadlessWindow::stroke(raster::Canvas &canvas,
+                              const geometry::Path &path, size_t first) const {
+    if (path.size() < first + 2) return 0;
+
+    auto iter = path.begin() + first;
+    if (_smooth) {
+        // the capsule is in float: far off ends are brought in first
+        double reach = _smooth / 2 + 1;
+        geometry::Box image{-reach, -reach, _width + reach, _height + reach};
+
+        auto a = iter->toGPS();
+        for (++iter; iter != path.end(); ++iter) {
+            auto b = iter->toGPS();
+            double t0, t1;
+            if (image.clip(a, b, t0, t1)) {
+                auto from = a + (b - a) * t0, to = a + (b - a) * t1;
+                canvas.smoothLine(from.x, from.y, to.x, to.y, _smooth, _color,
+                                  _left, _top);
+            }
+            a = b;
+        }
+        return path.size() - first - 1;
+    }
+
+    // truncate like SDL_Point conversion does in SDLWindow, but in double:
+    // far off points do not fit an int until they are clipped
+    auto a = iter->toGPS();
+    double ax = trunc(a.x), ay = trunc(a.y);
+
+    // one pixel of margin, as truncation maps (-1, 0] to 0
+    geometry::Box view{-1, -1, double(_width), double(_height)};
+
+    size_t segments{0};
+    for (++iter; iter != path.end(); ++iter) {
+        auto b = iter->toGPS();
+        double bx = trunc(b.x), by = trunc(b.y);
+
+        // inner points on the pixel of the previous one add nothing
+        if (bx == ax && by == ay && iter + 1 != path.end()) continue;
+
+        // only the part of the segment on the canvas is rasterized
+        double t0, t1;
+        geometry::Point pa(ax, ay), pb(bx, by);
+        if (view.clip(pa, pb, t0, t1)) {
+            auto from = pa + (pb - pa) * t0, to = pa + (pb - pa) * t1;
+            canvas.line(int(from.x) - _left, int(from.y) - _top,
+                        int(to.x) - _left, int(to.y) - _top, _color);
+        }
+
+        ax = bx;
+        ay = by;
+        ++segments;
+    }
+
+    return segments;
+}
+
+} /* ns: graphics */
+
+} /* ns: mlogo */
@@ -0,0 +1,198 @@
+/**
+ * @file: raster.hpp
+ *
+ * Software rasterizer and the headless Window built on it.
+ *
+ * The headless window draws into an in-memory RGBA framebuffer and never
+ * touches SDL, so it runs on machines without a display. It is selected by
+ * setting MLOGO_DRIVER=headless. The environment is read by Context for
+ * the display window only, never by the class: offscreen windows, such as
+ * tiles and replays, are not affected by it.
+ */
+
+#ifndef __RASTER_HPP__
+#define __RASTER_HPP__
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "allocation.hpp"
+#include "graphics.hpp"
+
+namespace mlogo {
+
+namespace graphics {
+
+namespace raster {
+
+/// Pixels [x0, x1] of row y.
+struct Span {
+    int x0, x1, y;
+};
+
+using Spans = allocation::Vector<Span, allocation::Subsystem::GRAPHICS>;
+
+/**
+ * RGBA framebuffer. Pixels are packed as 0xRRGGBBAA, row by row from the
+ * top left corner. Drawing outside the bounds is silently discarded.
+ */
+class Canvas {
+public:
+    using Pixel = uint32_t;
+
+    Canvas(int width, int height);
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+
+    void fill(const Color &c);
+    void fill(const Spans &spans, const Color &c);
+    void pixel(int x, int y, const Color &c);
+    Color pixel(int x, int y) const;
+
+    /// Bresenham line, both end points included.
+    void line(int x0, int y0, int x1, int y1, const Color &c);
+
+    /**
+     * Anti-aliased line, width pixels wide with round caps, between points
+     * of the plane where pixel (x, y) is the square [x, x + 1) x [y, y + 1).
+     * Pixels are blended with c, its alpha scaled by the coverage, which
+     * falls from 1 to 0 as the distance from the center of the pixel to the
+     * segment goes from (width - 1) / 2 to (width + 1) / 2. Rows are
+     * blended several pixels at a time with AVX2 or SSE2, where available.
+     *
+     * The canvas may be the part at (left, top) of a larger image that the
+     * points are in. Coverage is then computed in the coordinates of the
+     * image, so the tiles of an image match it pixel for pixel.
+     */
+    void smoothLine(double x0, double y0, double x1, double y1, double width,
+                    const Color &c, int left = 0, int top = 0);
+
+    /// smoothLine() a pixel at a time: the reference of the vector kernel.
+    void smoothLineScalar(double x0, double y0, double x1, double y1,
+                          double width, const Color &c, int left = 0,
+                          int top = 0);
+
+    const Pixel *data() const { return _pixels.data(); }
+    Pixel *data() { return _pixels.data(); }
+
+    /// Write the image as binary PPM (P6); alpha is dropped.
+    std::ostream &writePPM(std::ostream &s) const;
+
+    static Pixel pack(const Color &c) {
+        return Pixel(c.r) << 24 | Pixel(c.g) << 16 | Pixel(c.b) << 8 | c.a;
+    }
+
+    static Color unpack(Pixel p) {
+        return Color(p >> 24, (p >> 16) & 0xff, (p >> 8) & 0xff, p & 0xff);
+    }
+
+private:
+    void smoothLine(double x0, double y0, double x1, double y1, double width,
+                    const Color &c, int left, int top, bool vector);
+
+    bool inside(int x, int y) const {
+        return x >= 0 && y >= 0 && x < _width && y < _height;
+    }
+
+    int _width;
+    int _height;
+    allocation::Vector<Pixel, allocation::Subsystem::GRAPHICS> _pixels;
+};
+
+/// Binary PPM (P6), written in parts: the header, then rows of pixels.
+std::ostream &writePPMHeader(std::ostream &s, int width, int height);
+std::ostream &writePPMPixels(std::ostream &s, const Canvas::Pixel *pixels,
+                             std::size_t n);
+
+/**
+ * The 4-connected area of the color of pixel (x, y) around it, as spans.
+ * Every row of the area is scanned a bounded number of times, and the
+ * pixels visited are marked in a buffer kept by the thread and cleared
+ * span by span, so the cost is O(area) once the buffer has grown to the
+ * canvas. Nothing is found outside the canvas.
+ */
+void floodSpans(const Canvas &canvas, int x, int y, Spans &out);
+
+/**
+ * The pixels of a width x height canvas whose center is inside polygon,
+ * implicitly closed, by the even-odd rule. Rows are swept with a list of
+ * the active edges, so the cost is O(edges log edges + area).
+ *
+ * The canvas may be the part at (left, top) of a larger image that polygon
+ * is drawn on; spans are relative to the canvas.
+ */
+void polygonSpans(const geometry::Path &polygon, int width, int height,
+                  Spans &out, int left = 0, int top = 0);
+
+} /* ns: raster */
+
+class HeadlessWindow : public Window {
+public:
+    HeadlessWindow(int width, int height);
+    ~HeadlessWindow();
+
+    Window *background(const Color &color) override;
+    Window *foreground(const Color &color) override;
+    Window *clear() override;
+    using Window::draw;
+    Window *draw(const geometry::Path &path, std::size_t first) override;
+    Window *sprites(const geometry::Scene &sprites) override;
+    Window *hideSprite() override;
+    Window *setColor(const Color &c) override;
+    Window *fill(const geometry::Point &seed) override;
+    Window *fillPolygon(const geometry::Path &polygon,
+                        const Color &c) override;
+    Window *paint() override;
+    const raster::Canvas &picture() override { return _canvas; }
+
+    /**
+     * Make the canvas the part at (left, top) of an image of width x
+     * height pixels, which the reference systems of what is drawn map to.
+     * The tiles of an image drawn this way match it pixel for pixel.
+     */
+    void tile(int left, int top, int width, int height);
+
+    /**
+     * Draw anti-aliased lines width pixels wide (see Canvas::smoothLine()),
+     * or Bresenham lines if width is 0.
+     */
+    void smooth(double width) { _smooth = width; }
+
+    /**
+     * Write the last frame to filename when the window is destroyed, as PNG
+     * if the name ends with .png and as binary PPM otherwise; nowhere if
+     * filename is empty.
+     */
+    void snapshot(const std::string &filename) { _snapshot = filename; }
+
+    /// Drawn paths, without the sprite.
+    const raster::Canvas &canvas() const { return _canvas; }
+
+    /// What a display would show: the canvas with the sprites on top.
+    raster::Canvas frame() const;
+
+private:
+    /// Draw path from point first on canvas; return the segments drawn.
+    std::size_t stroke(raster::Canvas &canvas, const geometry::Path &path,
+                       std::size_t first) const;
+
+    raster::Canvas _canvas;
+    int _left{0}, _top{0};        //!< of the canvas in the image
+    int _width, _height;          //!< of the image
+    double _smooth{0};            //!< width of anti-aliased lines
+    geometry::Scene _sprites;
+    bool _showSprite{false};
+    Color _background{0, 0, 0};
+    Color _foreground{255, 255, 255};
+    Color _color{_foreground};
+    raster::Spans _spans;  //!< reused by the fills
+    std::string _snapshot;  //!< where to save the last frame on exit
+};
+
+} /* ns: graphics */
+
+} /* ns: mlogo */
+
+#endif /* __RASTER_HPP__ */
@@ -0,0 +1,391 @@
+/**
+ * @file: render_thread.cpp
+ * Implements render_thread.hpp
+ */
+
+#include "render_thread.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+#include "raster.hpp"
+
+using namespace std;
+
+namespace mlogo {
+
+namespace graphics {
+
+namespace {
+
+/// Spin a little, then yield, then sleep: waits are short while drawing.
+class Backoff {
+public:
+    void operator()() {
+        if (_n < 64) {
+            ++_n;
+        } else if (_n < 128) {
+            ++_n;
+            this_thread::yield();
+        } else {
+            this_thread::sleep_for(chrono::microseconds(500));
+        }
+    }
+
+    void reset() { _n = 0; }
+
+    /// Spun and yielded: next it would sleep.
+    bool exhausted() const { return _n >= 128; }
+
+private:
+    unsigned _n{0};
+};
+
+geometry::Point origin() { return geometry::Point(0, 0); }
+
+/// Rasterizers truncate coordinates, so these points are the same pixel.
+bool samePixel(double ax, double ay, double bx, double by) {
+    return int(ax) == int(bx) && int(ay) == int(by);
+}
+
+}  // namespace
+
+RenderThread::RenderThread(Factory open, bool cull)
+    : _queue(QUEUE_SIZE),
+      _cull(cull),
+      _polyline(origin()),
+      _polygon(origin()) {
+    _thread = thread(&RenderThread::loop, this, move(open));
+
+    Backoff wait;
+    while (!_ready.load(memory_order_acquire)) wait();
+
+    if (_error) {
+        _thread.join();
+        rethrow_exception(_error);
+    }
+}
+
+RenderThread::~RenderThread() {
+    Command stop{};
+    stop.type = Command::Type::STOP;
+    send(stop);
+
+    _thread.join();
+}
+
+Window *RenderThread::background(const Color &color) {
+    send(Command::Type::BACKGROUND, color);
+    return this;
+}
+
+Window *RenderThread::foreground(const Color &color) {
+    send(Command::Type::FOREGROUND, color);
+    return this;
+}
+
+Window *RenderThread::clear() {
+    Command c{};
+    c.type = Command::Type::CLEAR;
+    send(c);
+    return this;
+}
+
+Window *RenderThread::draw(const geometry::Path &path, size_t first) {
+    if (path.size() < first + 2) return this;
+
+    auto iter = path.begin() + first;
+    auto p = iter->toGPS();
+    moveTo(p.x, p.y);
+    for (++iter; iter != path.end(); ++iter) {
+        p = iter->toGPS();
+        lineTo(p.x, p.y, iter + 1 == path.end());
+    }
+
+    return this;
+}
+
+Window *RenderThread::draw(const geometry::Scene &scene, size_t first) {
+    if (first >= scene.size()) return this;
+
+    auto k = scene.pathOf(first);
+    auto i = max(scene.pathStart(k), first ? first - 1 : 0);
+
+    // all the points to send, to the screen in one pass
+    auto base = i, n = scene.size() - base;
+    _screenX.resize(n);
+    _screenY.resize(n);
+    scene.system().toGPS(scene.xs() + base, scene.ys() + base, n,
+                         _screenX.data(), _screenY.data());
+    auto x = _screenX.data() - base, y = _screenY.data() - base;
+
+    for (; k < scene.paths(); ++k) {
+        auto end = scene.pathEnd(k);
+        if (end - i < 2) {
+            i = end;
+            continue;
+        }
+
+        moveTo(x[i], y[i]);
+        for (++i; i < end; ++i) lineTo(x[i], y[i], i + 1 == end);
+    }
+
+    return this;
+}
+
+Window *RenderThread::sprites(const geometry::Scene &sprites) {
+    Command c{};
+    c.type = Command::Type::SPRITES;
+    send(c);
+    if (sprites.empty()) return this;
+
+    auto n = sprites.size();
+    _screenX.resize(n);
+    _screenY.resize(n);
+    sprites.system().toGPS(sprites.xs(), sprites.ys(), n, _screenX.data(),
+                           _screenY.data());
+
+    for (size_t k = 0; k < sprites.paths(); ++k) {
+        auto i = sprites.pathStart(k), end = sprites.pathEnd(k);
+        send(Command::Type::SPRITE_MOVE, _screenX[i], _screenY[i]);
+        for (++i; i < end; ++i)
+            send(Command::Type::SPRITE_LINE, _screenX[i], _screenY[i]);
+    }
+
+    return this;
+}
+
+Window *RenderThread::hideSprite() {
+    Command c{};
+    c.type = Command::Type::HIDE_SPRITE;
+    send(c);
+    return this;
+}
+
+Window *RenderThread::setColor(const Color &c) {
+    send(Command::Type::COLOR, c);
+    return this;
+}
+
+Window *RenderThread::fill(const geometry::Point &seed) {
+    auto p = seed.toGPS();
+    send(Command::Type::FILL, p.x, p.y);
+    return this;
+}
+
+Window *RenderThread::fillPolygon(const geometry::Path &polygon,
+                                  const Color &c) {
+    auto type = Command::Type::POLYGON_MOVE;
+    for (const auto &point : polygon) {
+        auto p = point.toGPS();
+        send(type, p.x, p.y);
+        type = Command::Type::POLYGON_LINE;
+    }
+    send(Command::Type::FILL_POLYGON, c);
+
+    return this;
+}
+
+Window *RenderThread::paint() {
+    Command c{};
+    c.type = Command::Type::PAINT;
+    send(c);
+    return this;
+}
+
+const raster::Canvas &RenderThread::picture() {
+    Command c{};
+    c.type = Command::Type::PICTURE;
+    send(c);
+    sync();
+    return *_picture;
+}
+
+void RenderThread::sync() {
+    Command c{};
+    c.type = Command::Type::SYNC;
+    c.ticket = ++_tickets;
+    send(c);
+
+    Backoff wait;
+    while (_synced.load(memory_order_acquire) < c.ticket) wait();
+}
+
+void RenderThread::send(const Command &c) {
+    Backoff wait;
+    while (!_queue.push(c)) wait();  // backpressure: the queue is full
+
+    // pairs with the fence in idle(): either the render thread sees the
+    // command before it blocks, or it is seen blocked and woken up
+    atomic_thread_fence(memory_order_seq_cst);
+    if (_idle.load(memory_order_relaxed)) {
+        lock_guard<mutex> lock(_idleMutex);
+        _wakeUp.notify_one();
+    }
+}
+
+void RenderThread::send(Command::Type type, const Color &color) {
+    Command c{};
+    c.type = type;
+    c.rgba = raster::Canvas::pack(color);
+    send(c);
+}
+
+void RenderThread::send(Command::Type type, double x, double y) {
+    Command c{};
+    c.type = type;
+    c.x = x;
+    c.y = y;
+    send(c);
+}
+
+void RenderThread::moveTo(double x, double y) {
+    _penX = x;
+    _penY = y;
+    send(Command::Type::MOVE, x, y);
+}
+
+void RenderThread::lineTo(double x, double y, bool last) {
+    // a segment within one pixel changes nothing, but the last one is kept
+    // so that a path never vanishes
+    if (_cull && !last && samePixel(_penX, _penY, x, y)) return;
+
+    _penX = x;
+    _penY = y;
+    send(Command::Type::LINE, x, y);
+}
+
+void RenderThread::loop(Factory open) {
+    try {
+        _target = open();
+    } catch (...) {
+        _error = current_exception();
+    }
+    _ready.store(true, memory_order_release);
+    if (!_target) return;
+
+    Backoff wait;
+    Command c;
+    while (true) {
+        if (!_queue.pop(c)) {
+            flush();
+            if (!wait.exhausted()) {
+                wait();
+                continue;
+            }
+            idle(c);
+        }
+
+        wait.reset();
+        if (!execute(c)) break;
+    }
+
+    delete _target;
+}
+
+void RenderThread::idle(Command &c) {
+    unique_lock<mutex> lock(_idleMutex);
+    _idle.store(true, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    _wakeUp.wait(lock, [this, &c]() { return _queue.pop(c); });
+    _idle.store(false, memory_order_relaxed);
+}
+
+bool RenderThread::execute(const Command &c) {
+    using Type = Command::Type;
+
+    geometry::Point p{c.x, c.y};
+    // a polyline or the sprites being sent are not complete yet
+    if (c.type != Type::LINE && c.type != Type::SPRITE_MOVE &&
+        c.type != Type::SPRITE_LINE)
+        flush();
+
+    switch (c.type) {
+    case Type::BACKGROUND:
+        _target->background(raster::Canvas::unpack(c.rgba));
+        break;
+    case Type::FOREGROUND:
+        _target->foreground(raster::Canvas::unpack(c.rgba));
+        break;
+    case Type::COLOR:
+        _target->setColor(raster::Canvas::unpack(c.rgba));
+        break;
+    case Type::CLEAR:
+        _target->clear();
+        break;
+    case Type::MOVE: {
+        // segments continuing the polyline are the common case
+        auto last = _polyline.last();
+        if (!samePixel(p.x, p.y, last.x, last.y) ||
+            _polyline.size() >= BATCH_SIZE) {
+            _polyline = geometry::Path(p);
+            _drawn = 0;
+        }
+        break;
+    }
+    case Type::LINE:
+        _polyline.push_back(p);
+        if (_polyline.size() > BATCH_SIZE) {
+            flush();
+            _polyline = geometry::Path(p);
+            _drawn = 0;
+        }
+        break;
+    case Type::SPRITES:
+        _sprites.clear();
+        _spriteChanged = true;
+        break;
+    case Type::SPRITE_MOVE:
+        _sprites.moveTo(p);
+        break;
+    case Type::SPRITE_LINE:
+        _sprites.lineTo(p);
+        break;
+    case Type::HIDE_SPRITE:
+        _target->hideSprite();
+        _spriteChanged = false;
+        break;
+    case Type::FILL:
+        _target->fill(p);
+        break;
+    case Type::POLYGON_MOVE:
+        _polygon = geometry::Path(p);
+        break;
+    case Type::POLYGON_LINE:
+        _polygon.push_back(p);
+        break;
+    case Type::FILL_POLYGON:
+        _target->fillPolygon(_polygon, raster::Canvas::unpack(c.rgba));
+        break;
+    case Type::PAINT:
+        _target->paint();
+        break;
+    case Type::PICTURE:
+        _picture = &_target->picture();
+        break;
+    case Type::SYNC:
+        _synced.store(c.ticket, memory_order_release);
+        break;
+    case Type::STOP:
+        return false;
+    }
+
+    return true;
+}
+
+void RenderThread::flush() {
+    if (_polyline.size() > _drawn + 1) {
+        _target->draw(_polyline, _drawn);
+        _drawn = _polyline.size() - 1;
+    }
+
+    if (_spriteChanged) {
+        _target->sprites(_sprites);
+        _spriteChanged = false;
+    }
+}
+
+} /* ns: graphics */
+
+} /* ns: mlogo */
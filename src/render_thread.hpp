@@ -0,0 +1,159 @@
+/**
+ * @file: render_thread.hpp
+ *
+ * Window proxy moving rendering to a dedicated thread.
+ *
+ * RenderThread implements Window by encoding every call into a small
+ * command pushed on a single-producer/single-consumer lock-free queue.
+ * The render thread owns the real window (created there by a factory),
+ * decodes commands, batches consecutive segments into one path and draws
+ * them. Points falling on the pixel of the previous one are not sent,
+ * unless the window draws anti-aliased lines.
+ * The interpreter blocks only when the queue is full; the render thread,
+ * once it has spun for a while on an empty queue, sleeps on a condition
+ * variable until the next command.
+ *
+ * Context uses it for headless windows unless MLOGO_RENDER_THREAD is "0",
+ * and for SDL windows only if it is "1": SDL wants its window on the main
+ * thread, and macOS requires it.
+ */
+
+#ifndef __RENDER_THREAD_HPP__
+#define __RENDER_THREAD_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "allocation.hpp"
+#include "graphics.hpp"
+#include "spsc_queue.hpp"
+
+namespace mlogo {
+
+namespace graphics {
+
+class RenderThread : public Window {
+public:
+    using Factory = std::function<Window *()>;
+
+    static constexpr std::size_t QUEUE_SIZE{1 << 14};
+    static constexpr std::size_t BATCH_SIZE{1024};  //!< points per draw
+
+    /**
+     * Start the render thread and create there the window with open.
+     * Pass cull false if the window draws anti-aliased lines, where even
+     * segments within a pixel change the coverage.
+     *
+     * @throw what open throws.
+     */
+    explicit RenderThread(Factory open, bool cull = true);
+    ~RenderThread();
+
+    Window *background(const Color &color) override;
+    Window *foreground(const Color &color) override;
+    Window *clear() override;
+    Window *draw(const geometry::Path &path, std::size_t first) override;
+    Window *draw(const geometry::Scene &scene, std::size_t first) override;
+    Window *sprites(const geometry::Scene &sprites) override;
+    Window *hideSprite() override;
+    Window *setColor(const Color &c) override;
+    Window *fill(const geometry::Point &seed) override;
+    Window *fillPolygon(const geometry::Path &polygon,
+                        const Color &c) override;
+    Window *paint() override;
+
+    /// Fetched by the render thread, once the commands sent are done.
+    const raster::Canvas &picture() override;
+
+    /// Wait until every command sent so far has been executed.
+    void sync();
+
+    /// The window drawn by the render thread: use it only after sync().
+    Window *target() const { return _target; }
+
+private:
+    struct Command {
+        enum class Type : uint8_t {
+            BACKGROUND,
+            FOREGROUND,
+            COLOR,
+            CLEAR,
+            MOVE,          //!< start a polyline at (x, y)
+            LINE,          //!< continue the polyline to (x, y)
+            SPRITES,       //!< start sending the sprites
+            SPRITE_MOVE,   //!< start a sprite at (x, y)
+            SPRITE_LINE,   //!< continue the sprite to (x, y)
+            HIDE_SPRITE,
+            FILL,          //!< flood fill from (x, y)
+            POLYGON_MOVE,  //!< start the polygon to fill at (x, y)
+            POLYGON_LINE,  //!< continue the polygon to (x, y)
+            FILL_POLYGON,  //!< fill the polygon with rgba
+            PAINT,
+            PICTURE,  //!< fetch the picture of the window
+            SYNC,
+            STOP
+        };
+
+        Type type;
+        uint32_t rgba;
+        uint64_t ticket;
+        double x, y;  //!< screen coordinates
+    };
+
+    void send(const Command &c);
+    void send(Command::Type type, const Color &c);
+    void send(Command::Type type, double x, double y);
+
+    /**
+     * Send a polyline in screen coordinates, skipping points on the pixel
+     * of the previous one if culling.
+     */
+    void moveTo(double x, double y);
+    void lineTo(double x, double y, bool last);
+
+    void loop(Factory open);
+    /// Block until a command arrives, and pop it into c.
+    void idle(Command &c);
+    bool execute(const Command &c);
+    void flush();
+
+    SpscQueue<Command,
+              allocation::Allocator<Command, allocation::Subsystem::GRAPHICS>>
+        _queue;
+    std::thread _thread;
+    Window *_target{nullptr};
+    std::exception_ptr _error;
+    std::atomic<bool> _ready{false};
+    std::mutex _idleMutex;
+    std::condition_variable _wakeUp;
+    std::atomic<bool> _idle{false};  //!< the render thread is blocked
+
+    using Coordinates =
+        allocation::Vector<double, allocation::Subsystem::GRAPHICS>;
+
+    // interpreter thread state
+    bool _cull;                      //!< skip points on the same pixel
+    double _penX{0}, _penY{0};       //!< last point sent
+    Coordinates _screenX, _screenY;  //!< scene points on the screen
+    uint64_t _tickets{0};            //!< last SYNC sent
+    std::atomic<uint64_t> _synced{0};
+
+    // render thread state
+    geometry::Path _polyline;
+    std::size_t _drawn{0};  //!< last point of _polyline already drawn
+    geometry::Scene _sprites;
+    bool _spriteChanged{false};
+    geometry::Path _polygon;
+    const raster::Canvas *_picture{nullptr};  //!< read after a sync
+};
+
+} /* ns: graphics */
+
+} /* ns: mlogo */
+
+#endif /* __RENDER_THREAD_HPP__ */
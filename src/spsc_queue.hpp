@@ -0,0 +1,87 @@
+/**
+ * @file: spsc_queue.hpp
+ *
+ * Bounded lock-free queue for exactly one producer and one consumer thread.
+ */
+
+#ifndef __SPSC_QUEUE_HPP__
+#define __SPSC_QUEUE_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace mlogo {
+
+/**
+ * Ring buffer of a power of two slots. push() is called only by the
+ * producer and pop() only by the consumer; neither blocks: they return
+ * false when the queue is full or empty.
+ *
+ * Each side keeps a private copy of the other side's index and reloads
+ * it only when the queue looks full (or empty), so in the common case a
+ * push or a pop touches one shared cache line.
+ */
+template <typename T, typename Alloc = std::allocator<T>>
+class SpscQueue {
+public:
+    explicit SpscQueue(std::size_t capacity)
+        : _slots(roundUp(capacity)), _mask(_slots.size() - 1) {}
+
+    bool push(const T &value) {
+        auto tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _headCache == _slots.size()) {
+            _headCache = _head.load(std::memory_order_acquire);
+            if (tail - _headCache == _slots.size()) return false;
+        }
+
+        _slots[tail & _mask] = value;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value) {
+        auto head = _head.load(std::memory_order_relaxed);
+        if (head == _tailCache) {
+            _tailCache = _tail.load(std::memory_order_acquire);
+            if (head == _tailCache) return false;
+        }
+
+        value = _slots[head & _mask];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) ==
+               _tail.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const { return _slots.size(); }
+
+private:
+    static std::size_t roundUp(std::size_t n) {
+        std::size_t size{1};
+        while (size < n) size <<= 1;
+        return size;
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    std::vector<T, Alloc> _slots;
+    const std::size_t _mask;
+
+    // consumer side
+    alignas(64) std::atomic<std::size_t> _head{0};
+    std::size_t _tailCache{0};
+
+    // producer side
+    alignas(64) std::atomic<std::size_t> _tail{0};
+    std::size_t _headCache{0};
+};
+
+} /* ns: mlogo */
+
+#endif /* __SPSC_QUEUE_HPP__ */
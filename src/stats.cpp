@@ -0,0 +1,86 @@
+/**
+ * @file: stats.cpp
+ * Implements stats.hpp
+ */
+
+#include "stats.hpp"
+
+#include <iomanip>
+
+using namespace std;
+
+namespace mlogo {
+
+namespace stats {
+
+void Stats::renderTime(uint64_t microseconds) {
+    size_t i{0};
+    while (microseconds && i < BUCKETS - 1) {
+        microseconds >>= 1;
+        ++i;
+    }
+
+    _histogram[i].fetch_add(1, memory_order_relaxed);
+}
+
+void Stats::reset() {
+    for (auto &c : _counters) c.store(0, memory_order_relaxed);
+    for (auto &b : _histogram) b.store(0, memory_order_relaxed);
+}
+
+ostream &Stats::report(ostream &s) const {
+    for (size_t i = 0; i < _counters.size(); ++i) {
+        auto c = static_cast<Counter>(i);
+        s << setw(20) << left << name(c) << " " << get(c) << endl;
+    }
+
+    s << "render time (us):" << endl;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        if (!bucket(i)) continue;
+
+        uint64_t from = i ? (1ull << (i - 1)) : 0;
+        s << "  " << setw(9) << right << from << " - ";
+        if (i < BUCKETS - 1)
+            s << setw(9) << left << (1ull << i);
+        else
+            s << setw(9) << left << "...";
+        s << " " << bucket(i) << endl;
+    }
+
+    return s;
+}
+
+const char *Stats::name(Counter c) {
+    switch (c) {
+    case Counter::PARSES:
+        return "parses";
+    case Counter::AST_NODES:
+        return "ast.nodes";
+    case Counter::FRAMES:
+        return "frames";
+    case Counter::VARIABLE_LOOKUPS:
+        return "variable.lookups";
+    case Counter::FRAME_WALKS:
+        return "frame.walks";
+    case Counter::PROCEDURE_MISSES:
+        return "procedure.misses";
+    case Counter::VALUE_COPIES:
+        return "value.copies";
+    case Counter::CONVERSIONS:
+        return "conversions";
+    case Counter::RENDERS:
+        return "renders";
+    case Counter::SEGMENTS:
+        return "segments";
+    case Counter::PRESENTS:
+        return "presents";
+    case Counter::COUNTERS:
+        break;
+    }
+
+    return "unknown";
+}
+
+} /* ns: stats */
+
+} /* ns: mlogo */
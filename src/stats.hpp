@@ -0,0 +1,95 @@
+/**
+ * @file: stats.hpp
+ *
+ * Interpreter-wide performance counters.
+ *
+ * Counters are always on: each one is a relaxed atomic increment, cheap
+ * enough to stay in hot paths like variable lookup. They are printed by
+ * the .STATS builtin and cleared by .STATS.RESET. SEGMENTS and PRESENTS
+ * are counted by the window, on the render thread if there is one, so
+ * .STATS waits for it to catch up first.
+ */
+
+#ifndef __STATS_HPP__
+#define __STATS_HPP__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+namespace mlogo {
+
+namespace stats {
+
+enum class Counter {
+    PARSES,             //!< statements parsed
+    AST_NODES,          //!< AST nodes allocated
+    FRAMES,             //!< memory frames opened
+    VARIABLE_LOOKUPS,   //!< variables looked up in the stack
+    FRAME_WALKS,        //!< frames visited by variable/procedure lookups
+    PROCEDURE_MISSES,   //!< frames visited without finding a procedure
+    VALUE_COPIES,       //!< ValueBox copies
+    CONVERSIONS,        //!< string <-> number conversions
+    RENDERS,            //!< Turtle::render() calls
+    SEGMENTS,           //!< segments drawn by the window
+    PRESENTS,           //!< frames presented on screen, by the window
+    COUNTERS            //!< number of counters, not a counter
+};
+
+class Stats {
+public:
+    /// Render time histogram buckets: [0,1), [1,2), [2,4) ... microseconds
+    static constexpr std::size_t BUCKETS{24};
+
+    static Stats &instance() {
+        static Stats _instance;
+        return _instance;
+    }
+
+    void add(Counter c, uint64_t n = 1) {
+        _counters[index(c)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t get(Counter c) const {
+        return _counters[index(c)].load(std::memory_order_relaxed);
+    }
+
+    /// Record the duration of one render in the histogram.
+    void renderTime(uint64_t microseconds);
+
+    uint64_t bucket(std::size_t i) const {
+        return _histogram.at(i).load(std::memory_order_relaxed);
+    }
+
+    void reset();
+
+    std::ostream &report(std::ostream &s) const;
+
+    static const char *name(Counter c);
+
+private:
+    Stats() { reset(); }
+
+    Stats(const Stats &) = delete;
+    Stats(Stats &&) = delete;
+
+    Stats &operator=(const Stats &) = delete;
+    Stats &operator=(Stats &&) = delete;
+
+    static std::size_t index(Counter c) { return static_cast<std::size_t>(c); }
+
+    std::array<std::atomic<uint64_t>, static_cast<std::size_t>(
+                                          Counter::COUNTERS)>
+        _counters;
+    std::array<std::atomic<uint64_t>, BUCKETS> _histogram;
+};
+
+/// Shortcut for Stats::instance().add(c, n)
+inline void count(Counter c, uint64_t n = 1) { Stats::instance().add(c, n); }
+
+} /* ns: stats */
+
+} /* ns: mlogo */
+
+#endif /* __STATS_HPP__ */
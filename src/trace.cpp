@@ -0,0 +1,118 @@
+/**
+ * @file: trace.cpp
+ * Implements trace.hpp
+ */
+
+#include "trace.hpp"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <stdexcept>
+
+using namespace std;
+
+namespace mlogo {
+
+namespace trace {
+
+namespace {
+
+/// Small sequential thread id, more readable than the native one.
+uint32_t threadId() {
+    static atomic<uint32_t> next{1};
+    thread_local uint32_t id{next++};
+
+    return id;
+}
+
+void writeEscaped(ostream &s, const string &str) {
+    for (auto ch : str) {
+        switch (ch) {
+        case '"':
+            s << "\\\"";
+            break;
+        case '\\':
+            s << "\\\\";
+            break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20)
+                s << ' ';
+            else
+                s << ch;
+        }
+    }
+}
+
+}  // namespace
+
+Tracer::Tracer() : _origin(chrono::steady_clock::now()) {
+    auto filename = getenv("MLOGO_TRACE");
+    if (filename && *filename) start(filename);
+}
+
+Tracer::~Tracer() { stop(); }
+
+void Tracer::start(const string &filename) {
+    stop();
+
+    lock_guard<mutex> lock(_mutex);
+    _out.open(filename);
+    if (!_out) throw logic_error("Cannot open trace file " + filename);
+
+    _out << "[";
+    _first = true;
+    _enabled = true;
+}
+
+void Tracer::stop() {
+    flush();
+
+    lock_guard<mutex> lock(_mutex);
+    _enabled = false;
+    if (_out.is_open()) {
+        _out << "]" << endl;
+        _out.close();
+    }
+}
+
+void Tracer::flush() {
+    lock_guard<mutex> lock(_mutex);
+    if (!_out.is_open()) return;
+
+    for (auto &e : _events) write(e);
+    _events.clear();
+    _out.flush();
+}
+
+uint64_t Tracer::now() const {
+    return chrono::duration_cast<chrono::microseconds>(
+               chrono::steady_clock::now() - _origin)
+        .count();
+}
+
+void Tracer::record(const char *category, const string &name,
+                    uint64_t start, uint64_t duration) {
+    lock_guard<mutex> lock(_mutex);
+    _events.push_back(Event{name, category, start, duration, threadId()});
+}
+
+size_t Tracer::pending() const {
+    lock_guard<mutex> lock(_mutex);
+    return _events.size();
+}
+
+void Tracer::write(const Event &e) {
+    if (!_first) _out << ",";
+    _first = false;
+
+    _out << "\n{\"name\":\"";
+    writeEscaped(_out, e.name);
+    _out << "\",\"cat\":\"" << e.category << "\",\"ph\":\"X\",\"ts\":"
+         << e.start << ",\"dur\":" << e.duration << ",\"pid\":" << getpid()
+         << ",\"tid\":" << e.tid << "}";
+}
+
+} /* ns: trace */
+
+} /* ns: mlogo */
@@ -0,0 +1,128 @@
+/**
+ * @file: trace.hpp
+ *
+ * Chrome trace-event recorder.
+ *
+ * When tracing is on, every Scope records a complete ("X") event with
+ * microsecond timestamps. Events are kept in memory and appended to the
+ * output file on flush() using the JSON Array Format, which can be loaded
+ * by chrome://tracing and Perfetto.
+ *
+ * Tracing is turned on by setting the MLOGO_TRACE environment variable to
+ * the name of the output file.
+ */
+
+#ifndef __TRACE_HPP__
+#define __TRACE_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mlogo {
+
+namespace trace {
+
+class Tracer {
+public:
+    static Tracer &instance() {
+        static Tracer _instance;
+        return _instance;
+    }
+
+    /**
+     * Start recording events into filename.
+     * If tracing is already active, buffered events are flushed into the
+     * previous file, which is then closed.
+     *
+     * @param[in] filename the output file.
+     * @throw std::logic_error if the file cannot be opened.
+     */
+    void start(const std::string &filename);
+
+    /// Flush buffered events, terminate the JSON array and stop recording.
+    void stop();
+
+    /// Append every buffered event to the output file.
+    void flush();
+
+    bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+    /// Microseconds elapsed since the tracer was created.
+    uint64_t now() const;
+
+    void record(const char *category, const std::string &name,
+                uint64_t start, uint64_t duration);
+
+    std::size_t pending() const;
+
+private:
+    struct Event {
+        std::string name;
+        const char *category;
+        uint64_t start;
+        uint64_t duration;
+        uint32_t tid;
+    };
+
+    Tracer();
+    ~Tracer();
+
+    Tracer(const Tracer &) = delete;
+    Tracer(Tracer &&) = delete;
+
+    Tracer &operator=(const Tracer &) = delete;
+    Tracer &operator=(Tracer &&) = delete;
+
+    void write(const Event &e);
+
+    std::chrono::steady_clock::time_point _origin;
+    std::atomic<bool> _enabled{false};
+    mutable std::mutex _mutex;
+    std::vector<Event> _events;
+    std::ofstream _out;
+    bool _first{true};
+};
+
+/**
+ * Record the lifetime of this object as a trace event.
+ * When tracing is off, the cost is one relaxed load and the name is
+ * not copied.
+ */
+class Scope {
+public:
+    Scope(const char *category, const std::string &name)
+        : _category(category) {
+        if (Tracer::instance().enabled()) {
+            _active = true;
+            _name = name;
+            _start = Tracer::instance().now();
+        }
+    }
+
+    ~Scope() {
+        if (_active) {
+            auto &tracer = Tracer::instance();
+            tracer.record(_category, _name, _start, tracer.now() - _start);
+        }
+    }
+
+private:
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+    const char *_category;
+    std::string _name;
+    bool _active{false};
+    uint64_t _start{0};
+};
+
+} /* ns: trace */
+
+} /* ns: mlogo */
+
+#endif /* __TRACE_HPP__ */
@@ -7,7 +7,16 @@
 
 #include "turtle_impl.hpp"
 
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
 #include "graphics.hpp"
+#include "interpreter.hpp"
+#include "perf.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 
 using namespace std;
 
@@ -15,32 +24,149 @@ namespace mlogo {
 
 namespace turtle {
 
-Turtle::Turtle() : impl(new _pImpl) { render(); }
+Turtle::Turtle() : impl(new _pImpl) {
+    auto env = getenv("MLOGO_JOURNAL");
+    if (env && *env) journal(env);
+
+    render();
+    InterpreterState::instance().onIdle([this]() {
+        if (impl->pending && impl->refresh) present();
+    });
+}
 
 Turtle::~Turtle() { delete impl; }
 
+Turtle &Turtle::select(const Numbers &numbers) {
+    impl->select(numbers);
+    render();
+    return *this;
+}
+
+Turtle::Numbers Turtle::selected() const {
+    return Numbers(impl->selected.begin(), impl->selected.end());
+}
+
+size_t Turtle::turtles() const { return impl->turtles.size(); }
+
+Turtle &Turtle::viewport(double x, double y, double zoom) {
+    impl->viewport(x, y, zoom);
+    render();
+    return *this;
+}
+
+tuple<double, double, double> Turtle::viewport() const {
+    return make_tuple(impl->viewX, impl->viewY, impl->zoom);
+}
+
 Turtle &Turtle::home() {
-    heading(0);
-    currentPosition(make_pair(0, 0));
+    impl->each([](_pImpl &t) {
+        t.setAngle(0);
+        t.moveTo(make_pair(0, 0));
+    });
     render();
 
     return *this;
 }
 
 Turtle &Turtle::clear() {
+    if (impl->journal) impl->journal->clear();
     impl->clearPaths();
     render();
     return *this;
 }
 
 Turtle &Turtle::forward(int steps) {
-    impl->walk(steps);
+    impl->walkSelected(steps);
     render();
     return *this;
 }
 
 Turtle &Turtle::right(double angle) {
-    impl->setAngle(impl->angle - Angle::Degrees(angle));
+    Angle turn{Angle::Degrees(angle)};
+    impl->each([&turn](_pImpl &t) { t.setAngle(t.angle - turn); });
+    render();
+    return *this;
+}
+
+Turtle &Turtle::arc(double angle, double radius) {
+    impl->each(
+        [angle, radius](_pImpl &t) { t.ellipse(angle, radius, radius); });
+    render();
+    return *this;
+}
+
+Turtle &Turtle::circle(double radius) { return arc(360, radius); }
+
+Turtle &Turtle::ellipse(double xRadius, double yRadius) {
+    impl->each(
+        [xRadius, yRadius](_pImpl &t) { t.ellipse(360, xRadius, yRadius); });
+    render();
+    return *this;
+}
+
+Turtle &Turtle::polygon(unsigned sides, double length) {
+    if (!sides) return *this;
+
+    Angle turn{Angle::Degrees(360.0 / sides)};
+    for (unsigned i = 0; i < sides; ++i) {
+        impl->walkSelected(length);
+        impl->each([&turn](_pImpl &t) { t.setAngle(t.angle - turn); });
+    }
+
+    render();
+    return *this;
+}
+
+Turtle &Turtle::fill() {
+    render();
+    auto window = GC::instance().window();
+    auto &journal = impl->journal;
+    impl->each([window, &journal](_pImpl &t) {
+        window->fill(t.onView(t.turtlePosition));
+        if (journal) journal->fill(t.turtlePosition);
+    });
+    render();
+    return *this;
+}
+
+Turtle &Turtle::beginFill() {
+    impl->fills.push_back({impl->scene.size(), impl->turtlePosition});
+    return *this;
+}
+
+Turtle &Turtle::endFill(uint8_t r, uint8_t g, uint8_t b) {
+    if (impl->fills.empty()) return *this;
+
+    // history is not flattened while filling: every vertex is in scene
+    render();
+    auto start = impl->fills.back();
+    impl->fills.pop_back();
+
+    const auto &scene = impl->scene;
+    Path polygon{impl->onView(start.from)};
+    for (auto i = start.first; i < scene.size(); ++i)
+        polygon.push_back(impl->onView(scene[i]));
+
+    auto window = GC::instance().window();
+    window->fillPolygon(polygon, graphics::Color(r, g, b));
+
+    if (impl->journal) {
+        Path shape{start.from};
+        for (auto i = start.first; i < scene.size(); ++i)
+            shape.push_back(scene[i]);
+        impl->journal->polygon(shape, graphics::Color(r, g, b));
+    }
+
+    // a collinear move may have extended the point before the first one
+    if (start.first < scene.size()) {
+        auto first = start.first ? start.first - 1 : 0;
+        if (impl->zoomed())
+            impl->drawInView(window, first);
+        else
+            window->draw(scene, first);
+        if (impl->journal) impl->journalSegments(first);
+    }
+
     render();
     return *this;
 }
@@ -48,36 +174,46 @@ Turtle &Turtle::right(double angle) {
 Turtle::Position Turtle::currentPosition() const { return impl->lastPos(); }
 
 Turtle &Turtle::currentPosition(const Position &pos) {
-    impl->moveTo(pos);
+    impl->each([&pos](_pImpl &t) { t.moveTo(pos); });
     render();
     return *this;
 }
 
 Turtle &Turtle::moveToPosition(const Position &pos) {
-    auto state = impl->pen.state;
-    penUp();
-    impl->moveTo(pos);
-    impl->pen.state = state;
+    impl->each([&pos](_pImpl &t) {
+        auto state = t.pen.state;
+        t.pen.state = Pen::State::UP;
+        t.moveTo(pos);
+        t.pen.state = state;
+    });
     render();
     return *this;
 }
 
 Turtle &Turtle::currentXPosition(int x) {
-    auto pos = currentPosition();
-    pos.first = x;
-    return currentPosition(pos);
+    impl->each([x](_pImpl &t) {
+        auto pos = t.lastPos();
+        pos.first = x;
+        t.moveTo(pos);
+    });
+    render();
+    return *this;
 }
 
 Turtle &Turtle::currentYPosition(int y) {
-    auto pos = currentPosition();
-    pos.second = y;
-    return currentPosition(pos);
+    impl->each([y](_pImpl &t) {
+        auto pos = t.lastPos();
+        pos.second = y;
+        t.moveTo(pos);
+    });
+    render();
+    return *this;
 }
 
 double Turtle::heading() const { return impl->angle.degrees().value(); }
 
 Turtle &Turtle::heading(double h) {
-    impl->setAngle(h);
+    impl->each([h](_pImpl &t) { t.setAngle(h); });
     render();
     return *this;
 }
@@ -101,13 +237,13 @@ double Turtle::towards(int x, int y) const {
 }
 
 Turtle &Turtle::showTurtle() {
-    impl->showTurtle = true;
+    impl->each([](_pImpl &t) { t.showTurtle = true; });
     render();
     return *this;
 }
 
 Turtle &Turtle::hideTurtle() {
-    impl->showTurtle = false;
+    impl->each([](_pImpl &t) { t.showTurtle = false; });
     render();
     return *this;
 }
@@ -115,12 +251,12 @@ Turtle &Turtle::hideTurtle() {
 bool &Turtle::visible() const { return impl->showTurtle; }
 
 Turtle &Turtle::penUp() {
-    impl->pen.state = Pen::State::UP;
+    impl->each([](_pImpl &t) { t.pen.state = Pen::State::UP; });
     return *this;
 }
 
 Turtle &Turtle::penDown() {
-    impl->pen.state = Pen::State::DOWN;
+    impl->each([](_pImpl &t) { t.pen.state = Pen::State::DOWN; });
     return *this;
 }
 
@@ -135,13 +271,102 @@ Pen &Turtle::pen() { return impl->pen; }
 
 const Pen &Turtle::pen() const { return impl->pen; }
 
+Turtle &Turtle::refresh(bool on) {
+    impl->refresh = on;
+    if (on && impl->pending) present();
+    return *this;
+}
+
+bool Turtle::refresh() const { return impl->refresh; }
+
+Turtle &Turtle::frameRate(unsigned fps) {
+    impl->fps = fps;
+    return *this;
+}
+
+unsigned Turtle::frameRate() const { return impl->fps; }
+
+Turtle &Turtle::update() {
+    present();
+    return *this;
+}
+
+Turtle &Turtle::historyLimit(size_t limit) {
+    impl->historyLimit = limit;
+    impl->flattenHistory();
+    return *this;
+}
+
+size_t Turtle::historyLimit() const { return impl->historyLimit; }
+
+Turtle &Turtle::journal(const string &filename) {
+    impl->journal.reset();
+    if (filename.empty()) return *this;
+
+    impl->journal.reset(new journal::Writer(filename, GC::SCREEN_WIDTH,
+                                            GC::SCREEN_HEIGHT));
+    impl->journaled = 0;
+    render();
+    return *this;
+}
+
+bool Turtle::journaling() const { return bool(impl->journal); }
+
+Turtle &Turtle::savePicture(const string &filename) {
+    static const string TRACE_NAME{"savepict"};
+    trace::Scope traceScope("turtle", TRACE_NAME);
+
+    ofstream out(filename, ios::binary);
+    if (!out) throw logic_error("Unable to open " + filename);
+
+    png::write(out, GC::instance().window()->picture(), impl->pictureLevel);
+    if (!out) throw logic_error("Unable to write " + filename);
+    return *this;
+}
+
+Turtle &Turtle::pictureLevel(png::Level level) {
+    impl->pictureLevel = level;
+    return *this;
+}
+
+png::Level Turtle::pictureLevel() const { return impl->pictureLevel; }
+
+void Turtle::present() {
+    GC::instance().window()->paint();
+    impl->pending = false;
+    impl->lastPresent = chrono::steady_clock::now();
+}
+
 void Turtle::render() {
-    GC::instance().window()->clear();
-    if (impl->showTurtle) {
-        GC::instance().window()->draw(impl->turtle());
+    // with a RenderThread, only the queueing: rasterizing is not traced
+    static const string TRACE_NAME{"render"};
+    trace::Scope traceScope("turtle", TRACE_NAME);
+    perf::PhaseScope phase(perf::Phase::RENDER);
+    auto start = chrono::steady_clock::now();
+
+    auto window = GC::instance().window();
+    if (impl->redraw) {
+        window->clear();
+        impl->redraw = false;
     }
-    for (auto p : impl->paths) GC::instance().window()->draw(p);
-    GC::instance().window()->paint();
+    impl->journalNewSegments();
+    impl->drawNewSegments(window);
+    impl->flattenHistory();
+
+    auto &sprites = impl->visibleSprites();
+    if (sprites.empty())
+        window->hideSprite();
+    else
+        window->sprites(sprites);
+
+    impl->pending = true;
+    if (impl->refresh && impl->frameDue()) present();
+
+    stats::count(stats::Counter::RENDERS);
+    stats::Stats::instance().renderTime(
+        chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - start)
+            .count());
 }
 
 std::ostream &operator<<(std::ostream &s, const Mode &value) {
@@ -8,8 +8,14 @@
 #ifndef __TURTLE_HPP__
 #define __TURTLE_HPP__
 
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <string>
 #include <tuple>
+#include <vector>
+
+#include "png.hpp"
 
 namespace mlogo {
 
@@ -29,17 +35,63 @@ struct Pen {
 class Turtle {
 public:
     using Position = std::pair<int, int>;
+    using Numbers = std::vector<std::size_t>;
+
+    static constexpr std::size_t MAX_TURTLES{1 << 16};
+    static constexpr unsigned MAX_POLYGON_SIDES{4096};
 
     static Turtle &instance() {
         static Turtle _instance;
         return _instance;
     }
 
+    /**
+     * Turtles are numbered from 0 and created, at home, when first
+     * selected. Commands apply to every selected turtle, queries to the
+     * first one; only turtle 0 exists and is selected at start.
+     */
+    Turtle &select(const Numbers &numbers);
+    Numbers selected() const;
+    std::size_t turtles() const;
+
+    /**
+     * The view: turtle point (x, y) at the center of the window, magnified
+     * zoom times. Changing it draws again the segments of the history in
+     * view; fills are not kept, and neither are segments already dropped
+     * by historyLimit().
+     */
+    Turtle &viewport(double x, double y, double zoom);
+    std::tuple<double, double, double> viewport() const;
+
     Turtle &home();
     Turtle &clear();
     Turtle &forward(int steps);
     Turtle &right(double angle);
 
+    /**
+     * Curves centered on the turtle, which does not move. The arc spans
+     * angle degrees clockwise from the heading; the ellipse has yRadius
+     * along the heading. Nothing is drawn with the pen up.
+     */
+    Turtle &arc(double angle, double radius);
+    Turtle &circle(double radius);
+    Turtle &ellipse(double xRadius, double yRadius);
+
+    /// Regular polygon walked from the turtle, turning right.
+    Turtle &polygon(unsigned sides, double length);
+
+    /// Paint with the pen color the area of the color under the turtle.
+    Turtle &fill();
+
+    /**
+     * Filled shapes: the points drawn between beginFill() and endFill()
+     * are the vertices of a polygon, from the position of the first
+     * selected turtle at the beginning, which endFill() paints with color
+     * r, g, b under the lines drawn meanwhile. They nest.
+     */
+    Turtle &beginFill();
+    Turtle &endFill(uint8_t r, uint8_t g, uint8_t b);
+
     Position currentPosition() const;
     Turtle &currentPosition(const Position &pos);
     Turtle &moveToPosition(const Position &pos);
@@ -67,6 +119,50 @@ public:
     Pen &pen();
     const Pen &pen() const;
 
+    /**
+     * Presentation of the drawing.
+     *
+     * Drawing commands are presented at most frameRate() times per second
+     * (every command if it is 0) and when the interpreter goes idle.
+     * With refresh(false) only update() presents.
+     */
+    Turtle &refresh(bool on);
+    bool refresh() const;
+    Turtle &frameRate(unsigned fps);
+    unsigned frameRate() const;
+    Turtle &update();
+
+    /**
+     * Bound the drawing history to about limit points (0: unbounded).
+     *
+     * Segments are kept only to be drawn: once on the canvas, which keeps
+     * them as pixels, those over the limit are dropped, so an endless
+     * drawing program runs in constant memory. CLEAN and CS reset both.
+     * A new viewport() does not draw the dropped segments again.
+     */
+    Turtle &historyLimit(std::size_t limit);
+    std::size_t historyLimit() const;
+
+    /**
+     * Record the drawing, from the history still kept, into a binary
+     * journal (see journal.hpp) that mlogo-render draws again at any
+     * resolution. An empty filename stops recording.
+     *
+     * @throw std::logic_error if the file cannot be opened.
+     */
+    Turtle &journal(const std::string &filename);
+    bool journaling() const;
+
+    /**
+     * Save the drawing, without the turtles, as a PNG file compressed at
+     * pictureLevel(), FAST by default, on every core.
+     *
+     * @throw std::logic_error if the file cannot be written.
+     */
+    Turtle &savePicture(const std::string &filename);
+    Turtle &pictureLevel(png::Level level);
+    png::Level pictureLevel() const;
+
 private:
     Turtle();
     ~Turtle();
@@ -78,6 +174,7 @@ private:
     Turtle &operator=(Turtle &&) = delete;
 
     void render();
+    void present();
 
     struct _pImpl;
     _pImpl *impl;
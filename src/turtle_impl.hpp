@@ -10,12 +10,17 @@
 
 #include "turtle.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iostream>
+#include <memory>
 #include <vector>
 
+#include "allocation.hpp"
 #include "geometry.hpp"
 #include "graphics.hpp"
+#include "journal.hpp"
 
 using namespace std;
 using namespace mlogo::geometry;
@@ -30,6 +35,9 @@ static constexpr int TURTLE_HEIGHT{10};
 static constexpr int TURTLE_BASE{10};
 static constexpr int TURTLE_CENTER_X{GC::SCREEN_WIDTH / 2};
 static constexpr int TURTLE_CENTER_Y{GC::SCREEN_HEIGHT / 2};
+static constexpr unsigned DEFAULT_FPS{60};
+static constexpr double CURVE_TOLERANCE{0.25};  //!< pixels
+static constexpr unsigned MAX_CURVE_STEPS{4096};
 
 Path createTurle(const Reference &turtleSystem);
 
@@ -37,13 +45,22 @@ struct Turtle::_pImpl {
     _pImpl()
         : turtleSystem(1, TURTLE_CENTER_X, -1, TURTLE_CENTER_Y),
           angle(Angle::Degrees(0)),
+          rotation(Affine::rotation(angle)),
           turtlePosition(0, 0, turtleSystem),
           _turtle(createTurle(turtleSystem)),
           topLeft(turtleSystem.fromGPS(Point(0, 0))),
           bottomRight(
               turtleSystem.fromGPS(Point(GC::SCREEN_WIDTH, GC::SCREEN_HEIGHT))),
-          offsets(GC::SCREEN_WIDTH, GC::SCREEN_HEIGHT, turtleSystem) {
+          offsets(GC::SCREEN_WIDTH, GC::SCREEN_HEIGHT, turtleSystem),
+          screen(topLeft.x, bottomRight.y, bottomRight.x, topLeft.y),
+          scene(turtleSystem),
+          drawnTail(turtlePosition),
+          journaledTail(turtlePosition),
+          viewSystem(turtleSystem),
+          view(turtleSystem) {
         initPaths();
+        create(0);
+        selected.push_back(0);
     }
 
     ~_pImpl() { clearPaths(); }
@@ -53,12 +70,20 @@ struct Turtle::_pImpl {
         newPath();
     }
 
-    void clearPaths() { paths.clear(); }
+    void clearPaths() {
+        scene.clear();
+        grid.clear();
+        drawn = 0;
+        journaled = 0;
+        pathOwner = NO_OWNER;
+        redraw = true;
+        for (auto &f : fills) f.first = 0;
+    }
 
     void newPath() { newPath(make_pair(0, 0)); }
 
     void newPath(const Turtle::Position &o) {
-        paths.push_back(Path(toPoint(o)));
+        scene.moveTo(toPoint(o));
     }
 
     Turtle::Position lastPos() const { return toPosition(turtlePosition); }
@@ -69,36 +94,125 @@ struct Turtle::_pImpl {
         addPoint(current);
     }
 
-    void walk(int steps) {
+    void walk(double steps) {
         auto current = turtlePosition;
 
-        Point d{0, steps, turtleSystem};
-        d = d.rotate(angle).scale(xScrunch, yScrunch);
+        Point d{0.0, steps, turtleSystem};
+        d = (Affine::scale(xScrunch, yScrunch) * rotation).apply(d);
         current = current + d;
 
         addPoint(current);
     }
 
-    void addPoint(const Point &current) {
+    /**
+     * Move every selected turtle steps forward. The targets of all the
+     * turtles are computed first, in a loop over the contiguous turtle
+     * arrays that the compiler can vectorize; the selected ones are then
+     * appended to the scene. In WINDOW mode, which needs no clipping,
+     * they are moved there directly.
+     */
+    void walkSelected(double steps) {
+        if (selected.size() == 1) {
+            walk(steps);
+            return;
+        }
+
+        save();
+        auto n = turtles.size();
+        toX.resize(n);
+        toY.resize(n);
+
+        double *__restrict tx = toX.data(), *__restrict ty = toY.data();
+        const double *x = turtles.x.data(), *y = turtles.y.data();
+        const double *dirX = turtles.dirX.data(), *dirY = turtles.dirY.data();
+        double kx = steps * xScrunch, ky = steps * yScrunch;
+        for (size_t i = 0; i < n; ++i) {
+            tx[i] = x[i] + kx * dirX[i];
+            ty[i] = y[i] + ky * dirY[i];
+        }
+
+        if (mode == Mode::WINDOW) {
+            for (auto i : selected) {
+                if (turtles.pen[i].state == Pen::State::UP) continue;
+                scene.moveTo(Point(x[i], y[i], turtleSystem));
+                scene.lineTo(Point(tx[i], ty[i], turtleSystem));
+            }
+            for (auto i : selected) {
+                turtles.x[i] = tx[i];
+                turtles.y[i] = ty[i];
+            }
+            pathOwner = NO_OWNER;
+        } else {
+            for (auto i : selected) {
+                load(i);
+                addPoint(Point(tx[i], ty[i], turtleSystem));
+                save();
+            }
+        }
+
+        load(selected.front());
+    }
+
+    void addPoint(const Point &target) {
+        // the last path may belong to another turtle, or end elsewhere
+        if (pen.state == Pen::State::DOWN && pathOwner != current)
+            scene.moveTo(turtlePosition);
+
         switch (mode) {
         case Mode::WINDOW:
-            if (paths.empty()) paths.emplace_back(turtlePosition);
-
-            addTocurrentPath(current);
-            turtlePosition = current;
+            addTocurrentPath(target);
+            turtlePosition = target;
             break;
         case Mode::FENCE:
-            fenceLine(current);
+            fenceLine(target);
             break;
         case Mode::WRAP:
-            wrapLine(current);
+            wrapLine(target);
             break;
         }
+
+        pathOwner = pen.state == Pen::State::DOWN ? current : NO_OWNER;
+    }
+
+    /**
+     * Draw an arc of ellipse centered on the turtle, angle degrees
+     * clockwise from the heading, with yRadius along the heading. Chords
+     * stay within CURVE_TOLERANCE of the curve on the screen.
+     */
+    void ellipse(double angle, double xRadius, double yRadius) {
+        if (pen.state == Pen::State::UP) return;
+
+        // on the screen, as magnified by the view
+        double radius =
+            max(fabs(xRadius * xScrunch), fabs(yRadius * yScrunch)) * zoom;
+        double step = radius > CURVE_TOLERANCE
+                          ? 2 * acos(1 - CURVE_TOLERANCE / radius)
+                          : M_PI / 2;
+        // past a whole turn the curve only goes over itself
+        double span = max(-360.0, min(angle, 360.0)) * M_PI / 180;
+        auto n = size_t(min(ceil(fabs(span) / step), double(MAX_CURVE_STEPS)));
+        if (!n) return;
+
+        auto toScreen = Affine::translation(turtlePosition) *
+                        Affine::scale(xScrunch, yScrunch) * rotation;
+        vector<Point> points;
+        points.reserve(n + 1);
+        for (size_t i = 0; i <= n; ++i) {
+            double phi = span * i / n;
+            Point p{xRadius * std::sin(phi), yRadius * std::cos(phi),
+                    turtleSystem};
+            points.push_back(toScreen.apply(p));
+        }
+
+        curve(points);
     }
 
     void setAngle(double a) { setAngle(Angle::Degrees(a)); }
 
-    void setAngle(Angle a) { angle = a; }
+    void setAngle(Angle a) {
+        angle = a;
+        rotation = Affine::rotation(angle);
+    }
 
     Turtle::Position toPosition(const Point &p) const {
         return make_pair(p.x, p.y);
@@ -110,114 +224,438 @@ struct Turtle::_pImpl {
         return Point(p.first, p.second, turtleSystem);
     }
 
-    Path turtle() const {
-        return _turtle.rotate(angle).translate(turtlePosition);
+    /// Draw onto the canvas only the segments added since the last call.
+    void drawNewSegments(graphics::Window *window) {
+        // a collinear move has carried the last drawn point further
+        bool extended = drawn && scene[drawn - 1] != drawnTail;
+
+        if (zoomed()) {
+            if (extended || drawn < scene.size())
+                drawInView(window, drawn ? drawn - 1 : 0);
+        } else {
+            if (extended) {
+                Path extension{drawnTail};
+                window->draw(extension.push_back(scene[drawn - 1]));
+            }
+
+            window->draw(scene, drawn);
+        }
+
+        drawn = scene.size();
+        if (drawn) drawnTail = scene.last();
+    }
+
+    /// Record in the journal the segments added since the last call.
+    void journalNewSegments() {
+        if (!journal) return;
+
+        if (journaled && scene[journaled - 1] != journaledTail)
+            journal->lineTo(scene[journaled - 1]);
+
+        if (journaled < scene.size()) {
+            for (auto k = scene.pathOf(journaled); k < scene.paths(); ++k) {
+                auto start = scene.pathStart(k);
+                for (auto i = max(start, journaled); i < scene.pathEnd(k); ++i)
+                    if (i == start)
+                        journal->moveTo(scene[i]);
+                    else
+                        journal->lineTo(scene[i]);
+            }
+        }
+
+        journaled = scene.size();
+        if (journaled) journaledTail = scene.last();
+    }
+
+    /// Record again the segments from point first on, as drawn again.
+    void journalSegments(std::size_t first) {
+        for (auto k = scene.pathOf(first); k < scene.paths(); ++k) {
+            auto from = max(scene.pathStart(k), first ? first - 1 : 0);
+            journal->moveTo(scene[from]);
+            for (auto i = from + 1; i < scene.pathEnd(k); ++i)
+                journal->lineTo(scene[i]);
+        }
+    }
+
+    bool zoomed() const { return viewSystem != turtleSystem; }
+
+    /// p, in turtle coordinates, placed on the window through the view.
+    Point onView(const Point &p) const { return Point(p.x, p.y, viewSystem); }
+
+    /// Show turtle point (x, y) at the center, magnified zoom times.
+    void viewport(double x, double y, double zoom) {
+        viewX = x;
+        viewY = y;
+        this->zoom = zoom;
+        viewSystem = Reference(1 / zoom, TURTLE_CENTER_X - x * zoom,
+                               -1 / zoom, TURTLE_CENTER_Y + y * zoom);
+        view = Scene(viewSystem);
+
+        // everything still in the history is drawn again
+        drawn = 0;
+        redraw = true;
+    }
+
+    /// The visible area, in turtle coordinates, with a pixel of margin.
+    Box viewBox() const {
+        double w = (GC::SCREEN_WIDTH / 2 + 1) / zoom;
+        double h = (GC::SCREEN_HEIGHT / 2 + 1) / zoom;
+        return Box(viewX - w, viewY - h, viewX + w, viewY + h);
+    }
+
+    /**
+     * Draw through the view the segments of scene ending at points
+     * [first, scene.size()), clipped to it. The whole history is looked up
+     * in the grid, so only the segments in view are visited.
+     */
+    void drawInView(graphics::Window *window, size_t first) {
+        auto box = viewBox();
+        if (first == 0) {
+            grid.update(scene);
+            grid.query(scene, box, inView);
+        } else {
+            inView.clear();
+            for (auto i = first; i < scene.size(); ++i)
+                if (scene.pathStart(scene.pathOf(i)) != i) inView.push_back(i);
+        }
+
+        view.clear();
+        auto xs = scene.xs(), ys = scene.ys();
+        size_t previous{0};
+        bool connected{false};  // the last segment ended in view
+        for (auto i : inView) {
+            Point a{xs[i - 1], ys[i - 1], viewSystem};
+            Point b{xs[i], ys[i], viewSystem};
+            double t0, t1;
+            if (!box.clip(a, b, t0, t1)) {
+                connected = false;
+                continue;
+            }
+
+            if (!connected || previous + 1 != i || t0 > 0)
+                view.moveTo(a + (b - a) * t0);
+            view.lineTo(a + (b - a) * t1);
+            connected = t1 == 1;
+            previous = i;
+        }
+
+        window->draw(view, 0);
+    }
+
+    /// Drop drawn segments beyond historyLimit, keeping the pen position.
+    void flattenHistory() {
+        if (!historyLimit || scene.size() <= historyLimit) return;
+        if (drawn < scene.size() || !fills.empty()) return;
+
+        auto last = scene.last();
+        scene.clear();
+        grid.clear();
+        scene.moveTo(last);
+        drawn = scene.size();
+        journaled = scene.size();
+        journaledTail = last;
+    }
+
+    /// Add turtles, at home, up to number n.
+    void create(size_t n) {
+        while (turtles.size() <= n) {
+            turtles.x.push_back(0);
+            turtles.y.push_back(0);
+            turtles.angle.push_back(Angle::Degrees(0));
+            turtles.dirX.push_back(0);
+            turtles.dirY.push_back(1);
+            turtles.pen.push_back(Pen());
+            turtles.visible.push_back(true);
+        }
+    }
+
+    /// Store the state of the current turtle in turtles.
+    void save() {
+        turtles.x[current] = turtlePosition.x;
+        turtles.y[current] = turtlePosition.y;
+        turtles.angle[current] = angle;
+        turtles.dirX[current] = rotation.xy;
+        turtles.dirY[current] = rotation.yy;
+        turtles.pen[current] = pen;
+        turtles.visible[current] = showTurtle;
+    }
+
+    /// Make turtle i current, dropping the unsaved state of the current one.
+    void load(size_t i) {
+        current = i;
+        turtlePosition = Point(turtles.x[i], turtles.y[i], turtleSystem);
+        angle = turtles.angle[i];
+        rotation = rotationOf(i);
+        pen = turtles.pen[i];
+        showTurtle = turtles.visible[i];
+    }
+
+    /// The rotation by the heading of turtle i, from its direction.
+    Affine rotationOf(size_t i) const {
+        Affine m;
+        m.xx = m.yy = turtles.dirY[i];
+        m.xy = turtles.dirX[i];
+        m.yx = -turtles.dirX[i];
+        return m;
+    }
+
+    /// Select turtles, creating the missing ones.
+    void select(const Turtle::Numbers &numbers) {
+        if (numbers.empty()) return;
+
+        save();
+        create(*max_element(numbers.begin(), numbers.end()));
+        selected.assign(numbers.begin(), numbers.end());
+        load(selected.front());
+    }
+
+    /// Call f with each selected turtle current in turn.
+    template <typename F>
+    void each(F f) {
+        for (auto i : selected) {
+            save();
+            load(i);
+            f(*this);
+        }
+
+        save();
+        load(selected.front());
+    }
+
+    /**
+     * The sprites of the visible turtles, in screen coordinates: a window
+     * drawing them directly and one behind a RenderThread then start from
+     * the same floats.
+     */
+    const Scene &visibleSprites() {
+        save();
+        sprites.clear();
+        for (size_t i = 0; i < turtles.size(); ++i) {
+            if (!turtles.visible[i]) continue;
+
+            // placed through the view, but never magnified
+            auto m = Affine::translation(turtles.x[i], turtles.y[i]) *
+                     Affine::scale(1 / zoom, 1 / zoom) * rotationOf(i);
+            sprites.moveTo(onView(m.apply(*_turtle.begin())));
+            for (auto iter = _turtle.begin() + 1; iter != _turtle.end(); ++iter)
+                sprites.lineTo(onView(m.apply(*iter)));
+        }
+
+        return sprites;
     }
 
     Reference turtleSystem;
 
     Angle angle;
+    Affine rotation;  //!< by angle, computed when it changes
     Point turtlePosition;
 
-    vector<Path> paths;
     double xScrunch{1};
     double yScrunch{1};
     bool showTurtle{true};
     Mode mode{Mode::WRAP};
     Path _turtle;
     Point topLeft, bottomRight, offsets;
+    Box screen;  //!< the visible area, in turtle coordinates
     Pen pen;
 
+    Scene scene;           //!< every path drawn so far
+    static constexpr size_t NO_OWNER{~size_t(0)};
+    size_t pathOwner{NO_OWNER};  //!< turtle standing where scene ends
+    std::size_t drawn{0};  //!< points of scene already on canvas
+    Point drawnTail;       //!< where the canvas has the last of them
+    std::size_t historyLimit{0};  //!< points kept in scene, 0 for all
+
+    unique_ptr<journal::Writer> journal;
+    std::size_t journaled{0};  //!< points of scene already in the journal
+    Point journaledTail;       //!< where the journal has the last of them
+
+    png::Level pictureLevel{png::Level::FAST};
+
+    struct FillStart {
+        std::size_t first;  //!< first point of scene in the polygon
+        Point from;         //!< where the turtle was
+    };
+    vector<FillStart> fills;  //!< the shapes being filled, innermost last
+
+    template <typename T>
+    using Array = allocation::Vector<T, allocation::Subsystem::TURTLES>;
+
+    /**
+     * Every turtle, one array per field. The current turtle is worked on
+     * in the fields above and stored back by save().
+     */
+    struct Turtles {
+        Array<double> x, y;        //!< position, in turtle coordinates
+        Array<Angle> angle;
+        Array<double> dirX, dirY;  //!< a unit step along the heading
+        Array<Pen> pen;
+        Array<uint8_t> visible;
+
+        size_t size() const { return x.size(); }
+    } turtles;
+    Array<size_t> selected;  //!< what commands apply to, current first
+    size_t current{0};
+    Array<double> toX, toY;  //!< targets of walkSelected(), by turtle
+    Scene sprites;           //!< reused by visibleSprites()
+
+    Reference viewSystem;  //!< turtle coordinates as shown on the window
+    double viewX{0}, viewY{0}, zoom{1};
+    Grid grid;  //!< over scene, brought up to date when zoomed
+    Scene view;  //!< the segments in view, reused by drawInView()
+    vector<size_t> inView;
+    bool redraw{true};  //!< the canvas must be cleared first
+
+    bool refresh{true};
+    unsigned fps{DEFAULT_FPS};
+    bool pending{false};  //!< drawn but not presented yet
+    chrono::steady_clock::time_point lastPresent;
+
+    bool frameDue() const {
+        if (!fps) return true;
+        return chrono::steady_clock::now() - lastPresent >=
+               chrono::microseconds(1000000 / fps);
+    }
+
 private:
     void addTocurrentPath(const Point &point) {
         switch (pen.state) {
         case Pen::State::DOWN:
-            paths.back().push_back(point);
+            scene.extendTo(point);
             break;
         case Pen::State::UP:
-            paths.emplace_back(point);
+            // addPoint() starts a path when the pen goes down again
             break;
         }
     }
 
+    /**
+     * Move to current on the torus: the move is cut where it leaves the
+     * screen and goes on from the opposite edge, iteratively. When it
+     * enters the screen again where it first did, the path repeats, so
+     * the remaining whole laps are skipped.
+     */
     void wrapLine(const Point &current) {
-        Point next = current;
-        StraightLine line(turtlePosition, current);
-        Point middle = outOfBounds(line, current);
+        Point d = current - turtlePosition;
 
-        if (middle.x || middle.y) {
-            next = middle;
+        if (!screen.contains(turtlePosition)) {
+            turtlePosition = wrap(turtlePosition);
+            scene.moveTo(turtlePosition);
         }
-
-        if (paths.empty()) paths.emplace_back(turtlePosition);
-        addTocurrentPath(next);
-        turtlePosition = next;
-
-        if (next != current) {
-            Point next_cur{current};
-            if (turtlePosition.x == topLeft.x) {
-                turtlePosition.x = bottomRight.x;
-                next_cur.x += offsets.x;
-            } else if (turtlePosition.x == bottomRight.x) {
-                turtlePosition.x = topLeft.x;
-                next_cur.x -= offsets.x;
+        // first place entered after a wrap, and the length left there
+        Point lapStart{turtlePosition};
+        double lapRemaining{-1};
+
+        while (true) {
+            auto exit = screen.exit(turtlePosition, d);
+            auto t = exit.t;
+
+            if (t >= 1) {
+                // the steps summed across wraps drift: land on the target
+                turtlePosition += d;
+                auto target =
+                    screen.contains(current) ? current : wrap(current);
+                if (samePlace(turtlePosition, target)) turtlePosition = target;
+                addTocurrentPath(turtlePosition);
+                return;
             }
 
-            if (turtlePosition.y == topLeft.y) {
-                turtlePosition.y = bottomRight.y;
-                next_cur.y -= offsets.y;
-            } else if (turtlePosition.y == bottomRight.y) {
-                turtlePosition.y = topLeft.y;
-                next_cur.y += offsets.y;
+            Point edge = turtlePosition + d * t;
+            if (t > 0) addTocurrentPath(edge);
+            d *= 1 - t;
+
+            if (exit.vertical) edge.x = d.x > 0 ? screen.left : screen.right;
+            if (exit.horizontal) edge.y = d.y > 0 ? screen.bottom : screen.top;
+            turtlePosition = edge;
+            scene.moveTo(turtlePosition);
+
+            double remaining = hypot(d.x, d.y);
+            if (lapRemaining < 0) {
+                lapStart = turtlePosition;
+                lapRemaining = remaining;
+            } else if (lapRemaining > 0 &&
+                       samePlace(turtlePosition, lapStart)) {
+                double lap = lapRemaining - remaining;
+                d *= (remaining - floor(remaining / lap) * lap) / remaining;
+                lapRemaining = 0;  // skip once
             }
-
-            paths.emplace_back(turtlePosition);
-            wrapLine(next_cur);
         }
     }
 
-    void fenceLine(const Point &current) {
-        Point next = current;
-        StraightLine line(turtlePosition, current);
-        Point middle = outOfBounds(line, current);
+    static bool samePlace(const Point &a, const Point &b) {
+        static constexpr double LAP_EPSILON{1e-9};
+        return fabs(a.x - b.x) < LAP_EPSILON && fabs(a.y - b.y) < LAP_EPSILON;
+    }
 
-        if (middle.x || middle.y) {
-            next = middle;
-        }
+    /// p brought inside the screen, as on a torus.
+    Point wrap(const Point &p) const {
+        auto mod = [](double v, double low, double size) {
+            return low + fmod(fmod(v - low, size) + size, size);
+        };
 
-        if (paths.empty()) paths.emplace_back(turtlePosition);
-        addTocurrentPath(next);
-        turtlePosition = next;
+        Point q{p};
+        q.x = mod(p.x, screen.left, offsets.x);
+        q.y = mod(p.y, screen.bottom, offsets.y);
+        return q;
     }
 
-    Point outOfBounds(const StraightLine &line, const Point &current) {
-        Point middle(0, 0, current.system);
+    /**
+     * Draw the polyline points without moving the turtle: WINDOW draws it
+     * all, FENCE only what is on the screen, WRAP wraps it around.
+     */
+    void curve(const vector<Point> &points) {
+        auto center = turtlePosition;
 
-        if (current.x < topLeft.x) {
-            auto crossline = line.whenX(topLeft.x);
-            if ((crossline.y <= topLeft.y) && (crossline.y >= bottomRight.y)) {
-                middle = crossline;
-            }
-        } else if (current.x > bottomRight.x) {
-            auto crossline = line.whenX(bottomRight.x);
-            if ((crossline.y <= topLeft.y) && (crossline.y >= bottomRight.y)) {
-                middle = crossline;
+        switch (mode) {
+        case Mode::WINDOW:
+            scene.moveTo(points.front());
+            for (size_t i = 1; i < points.size(); ++i)
+                scene.extendTo(points[i]);
+            break;
+        case Mode::FENCE: {
+            bool connected{false};  // the last segment ended on the screen
+            for (size_t i = 1; i < points.size(); ++i) {
+                auto &a = points[i - 1], &b = points[i];
+                double t0, t1;
+                if (!screen.clip(a, b, t0, t1)) {
+                    connected = false;
+                    continue;
+                }
+
+                if (!connected || t0 > 0) scene.moveTo(a + (b - a) * t0);
+                scene.extendTo(a + (b - a) * t1);
+                connected = t1 == 1;
             }
+            break;
+        }
+        case Mode::WRAP:
+            turtlePosition = screen.contains(points.front())
+                                 ? points.front()
+                                 : wrap(points.front());
+            scene.moveTo(turtlePosition);
+            for (size_t i = 1; i < points.size(); ++i)
+                wrapLine(turtlePosition + (points[i] - points[i - 1]));
+            break;
         }
 
-        if (current.y > topLeft.y) {
-            auto crossline = line.whenY(topLeft.y);
-            if ((crossline.x >= topLeft.x) && (crossline.x <= bottomRight.x)) {
-                middle = crossline;
-            }
-        } else if (current.y < bottomRight.y) {
-            auto crossline = line.whenY(bottomRight.y);
-            if ((crossline.x >= topLeft.x) && (crossline.x <= bottomRight.x)) {
-                middle = crossline;
-            }
+        turtlePosition = center;
+        scene.moveTo(turtlePosition);
+        pathOwner = current;
+    }
+
+    /// Move to current, stopping at the screen edge.
+    void fenceLine(const Point &current) {
+        Point next = current;
+
+        // a turtle outside the screen, as left by WINDOW, moves freely
+        if (screen.contains(turtlePosition)) {
+            Point d = current - turtlePosition;
+            auto exit = screen.exit(turtlePosition, d);
+            if (exit.t < 1) next = turtlePosition + d * exit.t;
         }
 
-        return middle;
+        addTocurrentPath(next);
+        turtlePosition = next;
     }
 };
 
@@ -17,6 +17,7 @@
 #include "eval.hpp"
 #include "exceptions.hpp"
 #include "memory.hpp"
+#include "stats.hpp"
 
 using bad_get = boost::bad_get;
 
@@ -181,7 +182,12 @@ ValueBox::ValueBox(const ListValue &v) : _value(v) {}
 
 ValueBox::ValueBox(const Value &v) : _value(v) {}
 
+ValueBox::ValueBox(const ValueBox &v) : _value(v._value) {
+    stats::count(stats::Counter::VALUE_COPIES);
+}
+
 ValueBox &ValueBox::operator=(const ValueBox &v) {
+    stats::count(stats::Counter::VALUE_COPIES);
     _value = v._value;
     return *this;
 }
@@ -214,11 +220,20 @@ std::string ValueBox::toString(bool wBrackets) const {
     return ss.str();
 }
 
-double ValueBox::asDouble() const { return std::stod(word()); }
+double ValueBox::asDouble() const {
+    stats::count(stats::Counter::CONVERSIONS);
+    return std::stod(word());
+}
 
-int32_t ValueBox::asInteger() const { return std::stoi(word()); }
+int32_t ValueBox::asInteger() const {
+    stats::count(stats::Counter::CONVERSIONS);
+    return std::stoi(word());
+}
 
-uint32_t ValueBox::asUnsigned() const { return std::stoul(word()); }
+uint32_t ValueBox::asUnsigned() const {
+    stats::count(stats::Counter::CONVERSIONS);
+    return std::stoul(word());
+}
 
 bool ValueBox::toBool() const { return boost::to_upper_copy(word()) == "TRUE"; }
 
@@ -324,6 +339,7 @@ void BasicProcedure::setReturnValue(std::size_t output) const {
     std::stringstream ss;
     ss << output;
 
+    stats::count(stats::Counter::CONVERSIONS);
     setReturnValue(ss.str());
 }
 
@@ -331,6 +347,7 @@ void BasicProcedure::setReturnValue(int output) const {
     std::stringstream ss;
     ss << output;
 
+    stats::count(stats::Counter::CONVERSIONS);
     setReturnValue(ss.str());
 }
 
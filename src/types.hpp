@@ -14,6 +14,7 @@
 
 #include <boost/variant.hpp>
 
+#include "allocation.hpp"
 #include "parser.hpp"
 
 namespace mlogo {
@@ -28,11 +29,11 @@ namespace types {
 
 using WordValue = std::string;
 
-using Value =
-    boost::make_recursive_variant<WordValue,
-                                  std::vector<boost::recursive_variant_>>::type;
+using Value = boost::make_recursive_variant<
+    WordValue, allocation::Vector<boost::recursive_variant_,
+                                  allocation::Subsystem::VALUES>>::type;
 
-using ListValue = std::vector<Value>;
+using ListValue = allocation::Vector<Value, allocation::Subsystem::VALUES>;
 
 std::string toString(const Value &v);
 
@@ -44,6 +45,7 @@ public:
     ValueBox(bool v);
     ValueBox(const ListValue &v);
     ValueBox(const Value &v);
+    ValueBox(const ValueBox &v);
 
     ValueBox &operator=(const ValueBox &v);
 
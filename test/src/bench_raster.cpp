@@ -0,0 +1,91 @@
+/**
+ * @file: bench_raster.cpp
+ *
+ * Line kernels of the software canvas, in segments per second.
+ *
+ *     mlogo_bench [SEGMENTS] [LENGTH]
+ *
+ * Random segments up to LENGTH pixels long are drawn on a 1024 x 1024
+ * canvas with Bresenham, and anti-aliased with the scalar reference and
+ * with the vector kernel.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "raster.hpp"
+
+using namespace std;
+using namespace mlogo::graphics;
+
+namespace {
+
+constexpr int SIZE{1024};
+
+struct Segment {
+    double x0, y0, x1, y1;
+};
+
+double bench(const string &name, const vector<Segment> &segments,
+           const function<void(raster::Canvas &, const Segment &)> &draw,
+           double baseline = 0) {
+    raster::Canvas canvas(SIZE, SIZE);
+    canvas.fill(Color(0, 0, 0));
+
+    auto start = chrono::steady_clock::now();
+    for (const auto &s : segments) draw(canvas, s);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    auto rate = segments.size() / elapsed.count();
+    cout << left << setw(24) << name << right << setw(12) << fixed
+         << setprecision(0) << rate << " segments/s";
+    if (baseline) cout << setw(8) << setprecision(2) << rate / baseline << "x";
+    cout << endl;
+    return rate;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    size_t count = argc > 1 ? atol(argv[1]) : 200000;
+    double length = argc > 2 ? atof(argv[2]) : 64;
+
+    srand(1);
+    auto random = [](double range) { return rand() * range / RAND_MAX; };
+    vector<Segment> segments;
+    for (size_t i = 0; i < count; ++i) {
+        double x = random(SIZE), y = random(SIZE);
+        segments.push_back(
+            {x, y, x + random(2 * length) - length,
+             y + random(2 * length) - length});
+    }
+
+    Color white(255, 255, 255), glass(0, 128, 255, 128);
+    auto bresenham = [&white](raster::Canvas &c, const Segment &s) {
+        c.line(s.x0, s.y0, s.x1, s.y1, white);
+    };
+
+    cout << count << " segments up to " << length << " pixels long" << endl;
+    auto baseline = bench("bresenham", segments, bresenham);
+
+    for (double width : {1.0, 3.0}) {
+        cout << defaultfloat << "anti-aliased, " << width << " pixels wide:"
+             << endl;
+        bench("  scalar", segments,
+              [width, &glass](raster::Canvas &c, const Segment &s) {
+                  c.smoothLineScalar(s.x0, s.y0, s.x1, s.y1, width, glass);
+              },
+              baseline);
+        bench("  vector", segments,
+              [width, &glass](raster::Canvas &c, const Segment &s) {
+                  c.smoothLine(s.x0, s.y0, s.x1, s.y1, width, glass);
+              },
+              baseline);
+    }
+
+    return 0;
+}
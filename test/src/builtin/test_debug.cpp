@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+
+#include "allocation.hpp"
+#include "basic_builtin_test_case.hpp"
+#include "stats.hpp"
+
+using namespace std;
+using namespace mlogo;
+
+namespace mlogo::test::debug {
+
+class DebugBuiltInTestCase : public BasicBuiltInTestCase {};
+
+TEST_F(DebugBuiltInTestCase, statsCounters) {
+    using stats::Counter;
+    auto &s = stats::Stats::instance();
+
+    run(".stats.reset");
+    ASSERT_EQ(0u, s.get(Counter::PARSES));
+    ASSERT_EQ(0u, s.get(Counter::FRAMES));
+
+    run("print sum 1 2");
+    ASSERT_EQ(1u, s.get(Counter::PARSES));
+    ASSERT_EQ(2u, s.get(Counter::FRAMES));
+    ASSERT_LE(3u, s.get(Counter::AST_NODES));
+    ASSERT_LE(3u, s.get(Counter::CONVERSIONS));  // the sum too
+
+    auto report = run(".stats");
+    ASSERT_NE(string::npos, report.find("parses"));
+    ASSERT_NE(string::npos, report.find("presents"));
+    ASSERT_NE(string::npos, report.find("render time"));
+}
+
+TEST_F(DebugBuiltInTestCase, statsCountLookups) {
+    using stats::Counter;
+    auto &s = stats::Stats::instance();
+
+    run("make \"a 1");
+    run(".stats.reset");
+    run("print :a");
+
+    ASSERT_EQ(1u, s.get(Counter::VARIABLE_LOOKUPS));
+    ASSERT_EQ(0u, s.get(Counter::PROCEDURE_MISSES));
+}
+
+TEST_F(DebugBuiltInTestCase, nodes) {
+    using allocation::Subsystem;
+    auto &accounting = allocation::Accounting::instance();
+
+    auto before = accounting.usage(Subsystem::VALUES).totalBlocks;
+    run("make \"l [a b c]");
+    ASSERT_LT(before, accounting.usage(Subsystem::VALUES).totalBlocks);
+    ASSERT_LT(0u, accounting.usage(Subsystem::FRAMES).liveBlocks);
+
+    auto out = run("print nodes");
+    ASSERT_EQ(2, count(out.begin(), out.end(), ' ') + 1);
+
+    auto report = run(".nodes");
+    ASSERT_NE(string::npos, report.find("parse tree"));
+    ASSERT_NE(string::npos, report.find("turtle paths"));
+}
+
+}  // namespace mlogo::test::debug
@@ -0,0 +1,499 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+#include "basic_builtin_test_case.hpp"
+#include "graphics.hpp"
+#include "journal.hpp"
+#include "raster.hpp"
+#include "render_thread.hpp"
+#include "stats.hpp"
+#include "turtle.hpp"
+
+using namespace std;
+using namespace mlogo;
+
+namespace mlogo::test::graphics {
+
+using mlogo::graphics::Context;
+using mlogo::graphics::HeadlessWindow;
+using mlogo::graphics::RenderThread;
+
+class GraphicsBuiltInTestCase : public BasicBuiltInTestCase {
+protected:
+    void SetUp() override {
+        setenv("MLOGO_DRIVER", "headless", 1);
+        setenv("MLOGO_RENDER_THREAD", "1", 1);
+        BasicBuiltInTestCase::SetUp();
+
+        // the turtles are shared by every test: start from the defaults,
+        // whatever the previous test left behind
+        auto &turtle = turtle::Turtle::instance();
+        if (turtle.journaling()) turtle.journal("");
+        run("wrap tell 0 setviewport [0 0] zoom 1 sethistory 0");
+        run("setpictlevel \"fast st pd cs");
+    }
+
+    HeadlessWindow *window() const {
+        auto w = Context::instance().window();
+        if (auto thread = dynamic_cast<RenderThread *>(w)) {
+            thread->sync();
+            w = thread->target();
+        }
+
+        return dynamic_cast<HeadlessWindow *>(w);
+    }
+
+    bool lit(int x, int y) const {
+        return window()->canvas().pixel(x, y).r == 255;
+    }
+
+    /// lit, give or take a pixel: for curves, made of chords
+    bool litNear(int x, int y) const {
+        for (int dx = -1; dx <= 1; ++dx)
+            for (int dy = -1; dy <= 1; ++dy)
+                if (lit(x + dx, y + dy)) return true;
+        return false;
+    }
+};
+
+TEST_F(GraphicsBuiltInTestCase, headless) {
+    ASSERT_TRUE(Context::headless());
+    ASSERT_NE(nullptr, window());
+}
+
+TEST_F(GraphicsBuiltInTestCase, forwardDraws) {
+    run("fd 50");
+    ASSERT_EQ("0 50\n", run("print pos"));
+
+    // the origin is at the center of the screen, y grows upwards
+    ASSERT_TRUE(lit(Context::SCREEN_WIDTH / 2, Context::SCREEN_HEIGHT / 2));
+    ASSERT_TRUE(
+        lit(Context::SCREEN_WIDTH / 2, Context::SCREEN_HEIGHT / 2 - 25));
+    ASSERT_FALSE(
+        lit(Context::SCREEN_WIDTH / 2, Context::SCREEN_HEIGHT / 2 + 25));
+
+    run("cs");
+    ASSERT_FALSE(
+        lit(Context::SCREEN_WIDTH / 2, Context::SCREEN_HEIGHT / 2 - 25));
+}
+
+TEST_F(GraphicsBuiltInTestCase, collinearMovesDraw) {
+    int x = Context::SCREEN_WIDTH / 2;
+    int y = Context::SCREEN_HEIGHT / 2;
+
+    run("fd 10 fd 10 fd 10 bk 5");
+    ASSERT_TRUE(lit(x, y - 5));
+    ASSERT_TRUE(lit(x, y - 15));
+    ASSERT_TRUE(lit(x, y - 29));
+    ASSERT_FALSE(lit(x, y - 35));
+    ASSERT_EQ("0 25\n", run("print pos"));
+}
+
+TEST_F(GraphicsBuiltInTestCase, penUpDoesNotDraw) {
+    run("pu fd 50 pd");
+    ASSERT_FALSE(
+        lit(Context::SCREEN_WIDTH / 2, Context::SCREEN_HEIGHT / 2 - 25));
+}
+
+TEST_F(GraphicsBuiltInTestCase, spriteIsOnlyInFrame) {
+    // base of the turtle, 5 pixels below its position
+    int x = Context::SCREEN_WIDTH / 2 + 2;
+    int y = Context::SCREEN_HEIGHT / 2 + 5;
+
+    run("st");
+    ASSERT_FALSE(lit(x, y));
+    ASSERT_EQ(255, window()->frame().pixel(x, y).r);
+
+    run("ht");
+    ASSERT_EQ(0, window()->frame().pixel(x, y).r);
+}
+
+TEST_F(GraphicsBuiltInTestCase, refresh) {
+    auto presents = []() {
+        Context::instance().sync();
+        return stats::Stats::instance().get(stats::Counter::PRESENTS);
+    };
+
+    // with no frame rate limit every command is presented
+    run("setfps 0");
+    ASSERT_EQ("0\n", run("print fps"));
+    auto before = presents();
+    run("fd 10");
+    ASSERT_EQ(before + 1, presents());
+
+    // until NOREFRESH: then only UPDATEGRAPH presents, once
+    run("norefresh");
+    before = presents();
+    run("fd 10 rt 90 fd 10");
+    ASSERT_EQ(before, presents());
+    run("updategraph");
+    ASSERT_EQ(before + 1, presents());
+    run("fd 10");
+    ASSERT_EQ(before + 1, presents());
+
+    // REFRESH presents what is pending, and each command again
+    run("refresh");
+    ASSERT_EQ(before + 2, presents());
+    run("fd 10");
+    ASSERT_EQ(before + 3, presents());
+
+    run("setfps 60");
+    ASSERT_EQ("60\n", run("print fps"));
+}
+
+TEST_F(GraphicsBuiltInTestCase, statsWaitForTheWindow) {
+    // counted on the render thread: .STATS lets it catch up first
+    run(".stats.reset fd 10 updategraph");
+    istringstream report(run(".stats"));
+    string name;
+    uint64_t value;
+    map<string, uint64_t> counters;
+    while (report >> name >> value) counters[name] = value;
+
+    ASSERT_LE(1u, counters["segments"]);
+    ASSERT_LE(1u, counters["presents"]);
+}
+
+TEST_F(GraphicsBuiltInTestCase, wrap) {
+    int x = Context::SCREEN_WIDTH / 2;
+    int y = Context::SCREEN_HEIGHT / 2;
+
+    run("wrap rt 90 fd 700");
+    ASSERT_EQ("60 0\n", run("print pos"));
+    ASSERT_TRUE(lit(x + 300, y));
+    ASSERT_TRUE(lit(10, y));
+    ASSERT_TRUE(lit(x + 50, y));
+
+    // whole laps around the screen are not walked one by one
+    run("cs fd 1000000");
+    ASSERT_EQ("0 160\n", run("print pos"));
+    ASSERT_TRUE(lit(x, 1));
+    ASSERT_TRUE(lit(x, Context::SCREEN_HEIGHT - 1));
+
+    // a move across wraps lands exactly on its target
+    run("window cs pu setpos [2000 0] rt 37 fd 3 wrap home pd zoom 2 fd 50");
+    ASSERT_TRUE(lit(x, y - 50));
+    ASSERT_FALSE(lit(x - 1, y - 50));
+}
+
+TEST_F(GraphicsBuiltInTestCase, fence) {
+    run("fence fd 300");
+    ASSERT_EQ("0 240\n", run("print pos"));
+    run("rt 90 fd 1000");
+    ASSERT_EQ("320 240\n", run("print pos"));
+    ASSERT_TRUE(lit(Context::SCREEN_WIDTH / 2 + 100, 0));
+}
+
+TEST_F(GraphicsBuiltInTestCase, window) {
+    int x = Context::SCREEN_WIDTH / 2;
+
+    // the turtle leaves the screen, only what is on it is drawn
+    run("window fd 1000");
+    ASSERT_EQ("0 1000\n", run("print pos"));
+    run("bk 1000 rt 45 fd 1000");
+    ASSERT_TRUE(lit(x, 0));
+    ASSERT_TRUE(lit(x + 100, Context::SCREEN_HEIGHT / 2 - 100));
+}
+
+TEST_F(GraphicsBuiltInTestCase, curves) {
+    int x = Context::SCREEN_WIDTH / 2;
+    int y = Context::SCREEN_HEIGHT / 2;
+
+    // the turtle stays at the center
+    run("circle 100");
+    ASSERT_EQ("0 0\n", run("print pos"));
+    ASSERT_TRUE(litNear(x, y - 100));
+    ASSERT_TRUE(litNear(x + 100, y));
+    ASSERT_TRUE(litNear(x + 71, y + 71));
+    ASSERT_FALSE(litNear(x + 50, y));
+
+    // clockwise from the heading
+    run("cs arc 90 50");
+    ASSERT_TRUE(litNear(x + 35, y - 35));
+    ASSERT_FALSE(litNear(x - 50, y));
+
+    run("cs ellipse 100 50");
+    ASSERT_TRUE(litNear(x + 100, y));
+    ASSERT_TRUE(litNear(x, y - 50));
+
+    run("cs pu circle 30 pd");
+    ASSERT_FALSE(litNear(x + 30, y));
+
+    // chords are fine enough on the screen, whatever the zoom, and a
+    // span of many turns is one turn
+    auto onCircle = [&](double radius) {
+        for (int a = 0; a < 360; a += 3) {
+            double phi = a * M_PI / 180;
+            if (!litNear(x + lround(radius * std::sin(phi)),
+                         y - lround(radius * std::cos(phi))))
+                return false;
+        }
+        return true;
+    };
+    run("cs zoom 20 circle 10");
+    ASSERT_TRUE(onCircle(200));
+    run("zoom 1 cs arc 1000000 50");
+    ASSERT_TRUE(onCircle(50));
+    ASSERT_FALSE(litNear(x + 25, y));
+}
+
+TEST_F(GraphicsBuiltInTestCase, clippedCurves) {
+    int x = Context::SCREEN_WIDTH / 2;
+
+    run("fence circle 300");
+    ASSERT_TRUE(litNear(x + 300, Context::SCREEN_HEIGHT / 2));
+    ASSERT_EQ("0 0\n", run("print pos"));
+
+    run("cs wrap setxy 0 200 circle 100");
+    ASSERT_TRUE(litNear(x, Context::SCREEN_HEIGHT - 60));
+    ASSERT_EQ("0 200\n", run("print pos"));
+}
+
+TEST_F(GraphicsBuiltInTestCase, poly) {
+    int x = Context::SCREEN_WIDTH / 2;
+    int y = Context::SCREEN_HEIGHT / 2;
+
+    run("rt 90 poly 4 50");
+    ASSERT_EQ("0 0\n", run("print pos"));
+    ASSERT_EQ("90\n", run("print heading"));
+    ASSERT_TRUE(lit(x + 25, y));
+    ASSERT_TRUE(lit(x + 50, y + 25));
+    ASSERT_TRUE(lit(x + 25, y + 50));
+    ASSERT_TRUE(lit(x, y + 25));
+
+    // a negative length walks backwards, a fractional one is not cut
+    run("cs rt 90 poly 4 0 - 20.5");
+    ASSERT_EQ("0 0\n", run("print pos"));
+    ASSERT_TRUE(lit(x - 10, y));
+    ASSERT_TRUE(lit(x - 20, y - 10));
+    ASSERT_FALSE(lit(x + 10, y));
+
+    ASSERT_THROW(run("poly 2 10"), std::logic_error);
+    ASSERT_THROW(run("poly 1e9 1"), std::logic_error);
+    ASSERT_THROW(run("poly 3.5 50"), std::logic_error);
+}
+
+TEST_F(GraphicsBuiltInTestCase, fill) {
+    int x = Context::SCREEN_WIDTH / 2;
+    int y = Context::SCREEN_HEIGHT / 2;
+
+    run("repeat 4 [fd 20 rt 90] pu setpos [10 10] pd fill");
+    ASSERT_EQ(255, window()->canvas().pixel(x + 10, y - 10).g);
+    ASSERT_EQ(255, window()->canvas().pixel(x + 2, y - 18).g);
+    ASSERT_FALSE(lit(x - 10, y + 10));
+    ASSERT_FALSE(lit(x + 30, y - 10));
+}
+
+TEST_F(GraphicsBuiltInTestCase, filled) {
+    int x = Context::SCREEN_WIDTH / 2;
+    int y = Context::SCREEN_HEIGHT / 2;
+
+    run("filled [0 0 255] "
+        "[fd 40 rt 90 fd 40 rt 90 fd 40 rt 90 fd 40 rt 90]");
+    auto &canvas = window()->canvas();
+    ASSERT_EQ(255, canvas.pixel(x + 20, y - 20).b);
+    ASSERT_EQ(0, canvas.pixel(x + 20, y - 20).r);
+    ASSERT_EQ(0, canvas.pixel(x + 50, y - 20).b);
+
+    // the outline stays on top of the fill
+    ASSERT_TRUE(lit(x, y - 20));
+    ASSERT_TRUE(lit(x + 20, y - 40));
+
+    // a circle is filled around its center
+    run("cs filled [0 255 0] [circle 30]");
+    ASSERT_EQ(255, window()->canvas().pixel(x + 15, y + 15).g);
+    ASSERT_EQ(0, window()->canvas().pixel(x + 25, y + 25).g);
+
+    ASSERT_THROW(run("filled [1 2] [fd 10]"), std::logic_error);
+    ASSERT_THROW(run("filled [1 2 300] [fd 10]"), std::logic_error);
+}
+
+TEST_F(GraphicsBuiltInTestCase, turtles) {
+    int x = Context::SCREEN_WIDTH / 2;
+    int y = Context::SCREEN_HEIGHT / 2;
+
+    ASSERT_EQ("0\n", run("print who"));
+    ASSERT_EQ("0\n", run("print turtles"));
+
+    // new turtles start at home, then move together
+    run("tell [1 2] rt 90 fd 30");
+    ASSERT_EQ("1 2\n", run("print who"));
+    ASSERT_EQ("0 1 2\n", run("print turtles"));
+    ASSERT_EQ("30 0\n", run("print pos"));
+    ASSERT_TRUE(lit(x + 20, y));
+
+    run("tell 2 lt 180 fd 60");
+    ASSERT_EQ("-30 0\n", run("print pos"));
+    run("tell 1");
+    ASSERT_EQ("30 0\n", run("print pos"));
+
+    // ask runs the instructions with other turtles, then gives them back
+    run("ask 0 [fd 40]");
+    ASSERT_EQ("1\n", run("print who"));
+    ASSERT_TRUE(lit(x, y - 30));
+    run("tell 0");
+    ASSERT_EQ("0 40\n", run("print pos"));
+
+    // in WINDOW mode a batch move needs no clipping
+    run("window tell [0 1 2] pu home pd setheading 180 fd 20");
+    ASSERT_EQ("0 -20\n", run("print pos"));
+    ASSERT_TRUE(lit(x, y + 10));
+    run("tell 1 pu setpos [50 0] pd tell [0 1] fd 20");
+    run("tell 1");
+    ASSERT_EQ("50 -20\n", run("print pos"));
+    ASSERT_TRUE(lit(x + 50, y + 10));
+    ASSERT_FALSE(lit(x + 25, y + 20));  // no line between turtles
+
+    ASSERT_THROW(run("tell 100000"), std::logic_error);
+
+    // repeated numbers select the turtle once
+    run("tell [0 0] pu home rt 45 fd 10");
+    ASSERT_EQ("0\n", run("print who"));
+    ASSERT_EQ("45\n", run("print heading"));
+}
+
+TEST_F(GraphicsBuiltInTestCase, farMovesContinueThePath) {
+    auto &turtle = turtle::Turtle::instance();
+    string filename = testing::TempDir() + "mlogo_far.mlj";
+
+    // far from the origin, floats in the scene are coarser than a step
+    turtle.journal(filename);
+    run("cs pu setpos [300 0] rt 37 pd repeat 20 [fd 1]");
+    run("window cs pu setpos [2000 0] rt 37 pd repeat 20 [fd 1]");
+    turtle.journal("");
+
+    ifstream in(filename, ios::binary);
+    auto drawing = journal::Reader(in).read();
+    auto moves = count_if(
+        drawing.records.begin(), drawing.records.end(),
+        [](const journal::Drawing::Record &r) {
+            return r.op == journal::Op::MOVE;
+        });
+    ASSERT_LE(moves, 4);  // the home and the start of each line
+    remove(filename.c_str());
+}
+
+TEST_F(GraphicsBuiltInTestCase, viewport) {
+    int x = Context::SCREEN_WIDTH / 2;
+    int y = Context::SCREEN_HEIGHT / 2;
+
+    run("fd 50 pu fd 20 pd fd 10");
+    ASSERT_EQ("0 0 1\n", run("print viewport"));
+    ASSERT_FALSE(lit(x, y - 90));
+
+    // the history is drawn again, magnified around the center
+    run("zoom 2");
+    ASSERT_EQ("0 0 2\n", run("print viewport"));
+    ASSERT_TRUE(lit(x, y - 90));
+    ASSERT_FALSE(lit(x, y - 110));  // the gap
+    ASSERT_TRUE(lit(x, y - 150));
+
+    // and so are new segments
+    run("fd 10");
+    ASSERT_TRUE(lit(x, y - 170));
+
+    // (0, 50) in the middle
+    run("setviewport [0 50]");
+    ASSERT_TRUE(lit(x, y + 90));
+    ASSERT_FALSE(lit(x, y + 110));
+    ASSERT_TRUE(lit(x, y - 50));
+
+    // far away: nothing in view
+    run("setviewport [1000 1000]");
+    ASSERT_FALSE(lit(x, y));
+
+    ASSERT_THROW(run("zoom 0"), std::logic_error);
+    run("setviewport [0 0] zoom 1");
+    ASSERT_TRUE(lit(x, y - 25));
+}
+
+TEST_F(GraphicsBuiltInTestCase, boundedHistory) {
+    int x = Context::SCREEN_WIDTH / 2;
+    int y = Context::SCREEN_HEIGHT / 2;
+
+    run("sethistory 2");
+    ASSERT_EQ("2\n", run("print history"));
+
+    // dropped segments stay on the canvas and drawing goes on from the pen
+    run("fd 20 fd 20 fd 20 rt 90 fd 20");
+    ASSERT_TRUE(lit(x, y - 10));
+    ASSERT_TRUE(lit(x, y - 50));
+    ASSERT_TRUE(lit(x + 10, y - 60));
+
+    // but a new viewport cannot draw them again
+    run("setviewport [0 0]");
+    ASSERT_FALSE(lit(x, y - 10));
+    ASSERT_FALSE(lit(x + 10, y - 60));
+
+    run("cs");
+    ASSERT_FALSE(lit(x, y - 10));
+}
+
+TEST_F(GraphicsBuiltInTestCase, journalReplaysTheCanvas) {
+    auto &turtle = turtle::Turtle::instance();
+    string filename = testing::TempDir() + "mlogo_journal.mlj";
+
+    run("fd 20");
+    turtle.journal(filename);
+    ASSERT_TRUE(turtle.journaling());
+
+    // from the history still kept, through wraps, fills and clears
+    run("cs fd 50 rt 90 fd 30 pu fd 10 pd fd 10 fd 10 rt 90 fd 300");
+    run("filled [255 0 0] [fd 40 lt 90 fd 40 lt 90 fd 40]");
+    run("pu setpos [-200 -200] pd fd 20 rt 90 fd 20 rt 90 fd 20 rt 90 fd 20");
+    run("pu setpos [-190 -190] fill");
+
+    // end points off the grid of whole steps, from odd headings and curves
+    run("pu home pd rt 17 fd 97 rt 11 fd 61 circle 101 arc 77 53");
+    run("pu setpos [150 -150] pd ellipse 40 23");
+
+    // points on pixel boundaries, drawn live behind the render thread
+    auto display = Context::instance().window();
+    ASSERT_NE(nullptr, dynamic_cast<RenderThread *>(display));
+    run("pu home pd repeat 36 [fd 100 rt 170] arc 90 50");
+    turtle.journal("");
+    ASSERT_FALSE(turtle.journaling());
+
+    ifstream in(filename, ios::binary);
+    journal::Reader reader(in);
+    ASSERT_EQ(Context::SCREEN_WIDTH, reader.width());
+    ASSERT_EQ(Context::SCREEN_HEIGHT, reader.height());
+
+    HeadlessWindow replayed(reader.width(), reader.height());
+    reader.replay(&replayed, 1);
+
+    const auto &live = window()->canvas();
+    const auto &canvas = replayed.canvas();
+    ASSERT_TRUE(equal(live.data(),
+                      live.data() + live.width() * live.height(),
+                      canvas.data()));
+    remove(filename.c_str());
+}
+
+TEST_F(GraphicsBuiltInTestCase, savePicture) {
+    string filename = testing::TempDir() + "mlogo_picture.png";
+
+    ASSERT_EQ("fast\n", run("print pictlevel"));
+    run("fd 50 savepict \"" + filename);
+
+    ifstream in(filename, ios::binary);
+    string head(24, 0);
+    in.read(&head[0], head.size());
+    ASSERT_EQ(string("\x89PNG\r\n\x1a\n\0\0\0\rIHDR", 16),
+              head.substr(0, 16));
+
+    // 640 x 480
+    ASSERT_EQ(string("\0\0\x02\x80\0\0\x01\xe0", 8), head.substr(16));
+
+    run("setpictlevel \"best");
+    ASSERT_EQ("best\n", run("print pictlevel"));
+    ASSERT_THROW(run("setpictlevel \"zip"), std::logic_error);
+    remove(filename.c_str());
+}
+
+}  // namespace mlogo::test::graphics
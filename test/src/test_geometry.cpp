@@ -4,13 +4,19 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "exceptions.hpp"
 #include "geometry.hpp"
 
+using Affine = mlogo::geometry::Affine;
 using Angle = mlogo::geometry::Angle;
 using Reference = mlogo::geometry::Reference;
 using Point = mlogo::geometry::Point;
 using Path = mlogo::geometry::Path;
+using Box = mlogo::geometry::Box;
+using Grid = mlogo::geometry::Grid;
+using Scene = mlogo::geometry::Scene;
 using StraightLine = mlogo::geometry::StraightLine;
 
 namespace exceptions = mlogo::exceptions;
@@ -201,6 +207,29 @@ TEST(Angle, basicTrigonometry) {
     ASSERT_NEAR(1, tan(anAngle), 0.001);
 }
 
+TEST(Angle, hugeAngles) {
+    ASSERT_DOUBLE_EQ(280, Angle(Angle::Degrees(1e9)).degrees().value());
+    ASSERT_DOUBLE_EQ(80, Angle(Angle::Degrees(-1e9)).degrees().value());
+    ASSERT_DOUBLE_EQ(0, Angle(Angle::Degrees(-1e-20)).degrees().value());
+
+    Angle a{Angle::Degrees(10)};
+    a -= Angle::Degrees(1e12 + 20);
+    ASSERT_DOUBLE_EQ(70, a.degrees().value());
+}
+
+TEST(Angle, exactTrigonometry) {
+    for (int d = 0; d < 720; d += 15) {
+        Angle a{Angle::Degrees(d)};
+        ASSERT_NEAR(std::sin(d * M_PI / 180), a.sin(), 1e-14) << d;
+        ASSERT_NEAR(std::cos(d * M_PI / 180), a.cos(), 1e-14) << d;
+    }
+
+    ASSERT_EQ(1.0, Angle(Angle::Degrees(90)).sin());
+    ASSERT_EQ(0.0, Angle(Angle::Degrees(90)).cos());
+    ASSERT_EQ(-0.5, Angle(Angle::Degrees(210)).sin());
+    ASSERT_EQ(0.5, Angle(Angle::Degrees(-60)).cos());
+}
+
 TEST(Angle, inv) {
     Angle anAngle{Angle::Rad(3.14)};
 
@@ -211,6 +240,59 @@ TEST(Angle, inv) {
     ASSERT_FLOAT_EQ(5 / 3.14, (5 / anAngle).radians().value());
 }
 
+TEST(Grid, findsSegmentsInBox) {
+    Scene scene;
+    scene.moveTo(Point(0.0, 0.0)).lineTo(Point(10.0, 0.0));
+    scene.lineTo(Point(100.0, 100.0));
+    scene.moveTo(Point(500.0, 500.0)).lineTo(Point(510.0, 500.0));
+    scene.lineTo(Point(520.0, 500.0));
+
+    Grid grid;
+    grid.update(scene);
+
+    std::vector<std::size_t> found;
+    grid.query(scene, Box(-1, -1, 5, 5), found);
+    ASSERT_EQ(std::vector<std::size_t>({1}), found);
+
+    // crossing cells without an end point in them
+    grid.query(scene, Box(45, 45, 55, 55), found);
+    ASSERT_EQ(std::vector<std::size_t>({2}), found);
+
+    // the last segment is found before being indexed
+    grid.query(scene, Box(505, 495, 530, 505), found);
+    ASSERT_EQ(std::vector<std::size_t>({4, 5}), found);
+
+    grid.query(scene, Box(-1000, -1000, 1000, 1000), found);
+    ASSERT_EQ(std::vector<std::size_t>({1, 2, 4, 5}), found);
+
+    grid.query(scene, Box(200, 0, 300, 10), found);
+    ASSERT_TRUE(found.empty());
+}
+
+TEST(Grid, keepsLongSegmentsApart) {
+    Scene scene;
+    scene.moveTo(Point(-1e6, 0.0)).lineTo(Point(1e6, 0.0));
+    scene.lineTo(Point(1e6, 1.0));
+
+    Grid grid;
+    grid.update(scene);
+
+    std::vector<std::size_t> found;
+    grid.query(scene, Box(-1, -1, 1, 1), found);
+    ASSERT_EQ(std::vector<std::size_t>({1}), found);
+
+    // the index of a scene that has shrunk is dropped
+    scene.clear();
+    scene.moveTo(Point(5.0, 5.0));
+    grid.update(scene);
+    grid.query(scene, Box(-1, -1, 1, 1), found);
+    ASSERT_TRUE(found.empty());
+
+    scene.lineTo(Point(0.0, 0.0));
+    grid.query(scene, Box(-1, -1, 1, 1), found);
+    ASSERT_EQ(std::vector<std::size_t>({1}), found);
+}
+
 TEST(Reference, globalReference) {
     Reference global;
 
@@ -657,6 +739,169 @@ TEST(Path, constBeginEnd) {
     ASSERT_EQ(e, i);
 }
 
+TEST(Affine, compose) {
+    Reference ref{1, 320, -1, 240};
+    Point p{8, 5, ref};
+
+    auto m = Affine::translation(10, 20) * Affine::rotation(Angle::Degrees(90));
+    ASSERT_EQ(p.rotate(Angle::Degrees(90)) + Point(10, 20, ref), m.apply(p));
+
+    auto s = Affine::scale(2, 3) * Affine::identity();
+    ASSERT_EQ(Point(16, 15, ref), s.apply(p));
+
+    // reference systems
+    auto gps = ref.toGPS().apply(p);
+    ASSERT_EQ(p.toGPS(), Point(gps.x, gps.y));
+}
+
+TEST(Affine, bulk) {
+    Reference ref{1, 320, -1, 240};
+    auto m = ref.toGPS() * Affine::rotation(Angle::Degrees(30));
+
+    // not a multiple of the vector width
+    std::vector<float> xs, ys;
+    for (int i = 0; i < 13; ++i) {
+        xs.push_back(i * 1.5f - 7);
+        ys.push_back(20 - i * 3.25f);
+    }
+
+    std::vector<float> outX(xs.size()), outY(ys.size());
+    m.apply(xs.data(), ys.data(), xs.size(), outX.data(), outY.data());
+
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        auto p = m.apply(Point(double(xs[i]), double(ys[i])));
+        ASSERT_NEAR(p.x, outX[i], 1e-3);
+        ASSERT_NEAR(p.y, outY[i], 1e-3);
+    }
+
+    // in place
+    m.apply(xs.data(), ys.data(), xs.size(), xs.data(), ys.data());
+    ASSERT_EQ(outX, xs);
+    ASSERT_EQ(outY, ys);
+}
+
+TEST(Box, clip) {
+    Box box{-10, -5, 10, 5};
+    double t0, t1;
+
+    ASSERT_TRUE(box.contains(Point(10, 5)));
+    ASSERT_FALSE(box.contains(Point(10.5, 0.0)));
+
+    ASSERT_TRUE(box.clip(Point(-5, 0), Point(5, 0), t0, t1));
+    ASSERT_DOUBLE_EQ(0, t0);
+    ASSERT_DOUBLE_EQ(1, t1);
+
+    ASSERT_TRUE(box.clip(Point(-20, 0), Point(20, 0), t0, t1));
+    ASSERT_DOUBLE_EQ(0.25, t0);
+    ASSERT_DOUBLE_EQ(0.75, t1);
+
+    // vertical lines need no slope
+    ASSERT_TRUE(box.clip(Point(3, -10), Point(3, 10), t0, t1));
+    ASSERT_DOUBLE_EQ(0.25, t0);
+    ASSERT_DOUBLE_EQ(0.75, t1);
+    ASSERT_FALSE(box.clip(Point(11, -10), Point(11, 10), t0, t1));
+
+    // crossing near a corner, but outside
+    ASSERT_FALSE(box.clip(Point(6, 10), Point(16, 0), t0, t1));
+}
+
+TEST(Box, exit) {
+    Box box{-10, -5, 10, 5};
+
+    auto exit = box.exit(Point(0, 0), Point(0, 20));
+    ASSERT_DOUBLE_EQ(0.25, exit.t);
+    ASSERT_FALSE(exit.vertical);
+    ASSERT_TRUE(exit.horizontal);
+
+    exit = box.exit(Point(0, 0), Point(-20, 5));
+    ASSERT_DOUBLE_EQ(0.5, exit.t);
+    ASSERT_TRUE(exit.vertical);
+    ASSERT_FALSE(exit.horizontal);
+
+    // through a corner
+    exit = box.exit(Point(0, 0), Point(10, 5));
+    ASSERT_DOUBLE_EQ(1, exit.t);
+    ASSERT_TRUE(exit.vertical);
+    ASSERT_TRUE(exit.horizontal);
+
+    exit = box.exit(Point(0, 0), Point(0, 0));
+    ASSERT_TRUE(std::isinf(exit.t));
+    ASSERT_FALSE(exit.vertical || exit.horizontal);
+}
+
+TEST(Scene, paths) {
+    Reference ref{1, 320, -1, 240};
+    Scene scene{ref};
+
+    ASSERT_TRUE(scene.empty());
+    ASSERT_EQ(0u, scene.paths());
+
+    scene.lineTo(Point(0, 0, ref)).lineTo(Point(10, 0, ref));
+    scene.lineTo(Point(10, 10, ref));
+    scene.moveTo(Point(-5.0, 2.5, ref)).lineTo(Point(-5, -5, ref));
+    scene.moveTo(Point(1, 1, ref));
+
+    ASSERT_EQ(6u, scene.size());
+    ASSERT_EQ(3u, scene.paths());
+    ASSERT_EQ(Point(1, 1, ref), scene.last());
+    ASSERT_EQ(Point(-5.0, 2.5, ref), scene[3]);
+
+    ASSERT_EQ(0u, scene.pathStart(0));
+    ASSERT_EQ(3u, scene.pathEnd(0));
+    ASSERT_EQ(3u, scene.pathStart(1));
+    ASSERT_EQ(5u, scene.pathEnd(1));
+    ASSERT_EQ(6u, scene.pathEnd(2));
+
+    ASSERT_EQ(0u, scene.pathOf(2));
+    ASSERT_EQ(1u, scene.pathOf(3));
+    ASSERT_EQ(2u, scene.pathOf(5));
+
+    auto path = scene.path(0, 1);
+    ASSERT_EQ(2u, path.size());
+    auto i = path.begin();
+    ASSERT_EQ(Point(10, 0, ref), *(i++));
+    ASSERT_EQ(Point(10, 10, ref), *(i++));
+    ASSERT_EQ(i, path.end());
+
+    scene.clear();
+    ASSERT_TRUE(scene.empty());
+    ASSERT_EQ(0u, scene.paths());
+}
+
+TEST(Scene, extendTo) {
+    Reference ref{1, 320, -1, 240};
+    Scene scene{ref};
+
+    scene.moveTo(Point(0, 0, ref)).extendTo(Point(0, 10, ref));
+    ASSERT_EQ(2u, scene.size());
+
+    // collinear moves in the same direction move the last point
+    scene.extendTo(Point(0, 20, ref)).extendTo(Point(0, 35, ref));
+    ASSERT_EQ(2u, scene.size());
+    ASSERT_EQ(Point(0, 35, ref), scene.last());
+
+    // going back, or turning even slightly, adds a segment
+    scene.extendTo(Point(0, 30, ref));
+    ASSERT_EQ(3u, scene.size());
+    scene.extendTo(Point(0.5, 20.0, ref));
+    ASSERT_EQ(4u, scene.size());
+
+    // diagonal
+    scene.moveTo(Point(0, 0, ref)).extendTo(Point(3, 4, ref));
+    scene.extendTo(Point(6, 8, ref));
+    ASSERT_EQ(6u, scene.size());
+    ASSERT_EQ(2u, scene.paths());
+}
+
+TEST(Scene, otherReference) {
+    Reference ref{1, 320, -1, 240};
+    Scene scene{ref};
+
+    scene.moveTo(Point(320, 240));
+    ASSERT_EQ(Point(0, 0, ref), scene.last());
+    ASSERT_EQ(ref, scene.system());
+}
+
 TEST(StraightLine, basicLine) {
     StraightLine line{1, 0};  // from m and q
 
@@ -50,6 +50,27 @@ TEST(Interpreter, onePrintMethod) {
     ASSERT_EQ("CHECK INFO FILE FOR MORE INFORMATIONS\n", ss.str());
 }
 
+TEST(Interpreter, idleBeforeEachLine) {
+    static int idle{0};
+    auto &state = InterpreterState::instance();
+    state.resume(); /* a previous test may have said BYE */
+    auto hook = state.onIdle([]() { ++idle; });
+
+    std::stringstream is("MAKE \"A 1\nMAKE \"B 2\n"), os;
+    Stack::instance().clear(); /* clear memory state */
+    auto interpreter = getInterpreter(is, os, os, false);
+    initBuiltInProcedures();
+
+    idle = 0;
+    interpreter.run();
+    state.removeIdle(hook);
+    ASSERT_EQ(3, idle);
+
+    // removed hooks are not called anymore
+    state.idle();
+    ASSERT_EQ(3, idle);
+}
+
 /** relative path may change
 TEST(Interpreter, interpretFileCastle) {
     Stack::instance().clear();
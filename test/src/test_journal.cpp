@@ -0,0 +1,279 @@
+/**
+ * @file: test_journal.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "journal.hpp"
+#include "raster.hpp"
+
+using namespace std;
+
+using Color = mlogo::graphics::Color;
+using HeadlessWindow = mlogo::graphics::HeadlessWindow;
+using Path = mlogo::geometry::Path;
+using Point = mlogo::geometry::Point;
+using Reader = mlogo::journal::Reader;
+using Writer = mlogo::journal::Writer;
+
+namespace {
+
+bool lit(const HeadlessWindow &w, int x, int y) {
+    return w.canvas().pixel(x, y).r == 255;
+}
+
+}  // namespace
+
+TEST(Journal, deltasAreCompact) {
+    stringstream s;
+    {
+        Writer w(s, 32, 24);
+        w.moveTo(Point(0, 0));
+        for (int i = 1; i <= 100; ++i) w.lineTo(Point(i % 2, i));
+    }
+
+    // header + 101 records of one opcode and two one byte deltas
+    ASSERT_EQ(3u + 1 + 1 + 1 + 101 * 3, s.str().size());
+
+    // coordinates are fixed point, in 1/16 of a step
+    stringstream far;
+    Writer(far, 32, 24).lineTo(Point(100.5, -0.0625));
+    ASSERT_EQ(6u + 1 + 2 + 1, far.str().size());
+}
+
+TEST(Journal, offGridCoordinatesAreExact) {
+    double floats[]{376.99f, -0.3f, 1e-7f}, doubles[]{0.1, -1e300};
+    stringstream s;
+    {
+        Writer w(s, 32, 24);
+        for (auto v : floats) w.lineTo(Point(v, 2.5));
+        for (auto v : doubles) w.fill(Point(v, v));
+    }
+
+    stringstream in(s.str());
+    auto drawing = Reader(in).read();
+    ASSERT_EQ(5u, drawing.x.size());
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_EQ(floats[i], drawing.x[i]);
+        ASSERT_EQ(2.5, drawing.y[i]);
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        ASSERT_EQ(doubles[i], drawing.x[3 + i]);
+        ASSERT_EQ(doubles[i], drawing.y[3 + i]);
+    }
+}
+
+TEST(Journal, replaysAtAnyScale) {
+    stringstream s;
+    {
+        Writer w(s, 32, 24);
+        w.moveTo(Point(0, 0));
+        w.lineTo(Point(10, 0));
+        w.moveTo(Point(-5, 5));
+        w.lineTo(Point(-5, 10));
+    }
+
+    for (int scale : {1, 3}) {
+        stringstream in(s.str());
+        Reader r(in);
+        ASSERT_EQ(32, r.width());
+        ASSERT_EQ(24, r.height());
+
+        HeadlessWindow w(32 * scale, 24 * scale);
+        ASSERT_EQ(4u, r.replay(&w, scale));
+
+        // the origin is at the center, y grows upwards
+        int x = 16 * scale, y = 12 * scale;
+        ASSERT_TRUE(lit(w, x, y));
+        ASSERT_TRUE(lit(w, x + 10 * scale, y));
+        ASSERT_TRUE(lit(w, x - 5 * scale, y - 10 * scale));
+
+        // pen up moves draw nothing
+        ASSERT_FALSE(lit(w, x - 2 * scale, y - 2 * scale));
+    }
+}
+
+TEST(Journal, farAwaySegmentsAreClipped) {
+    stringstream s;
+    {
+        Writer w(s, 32, 24);
+        w.moveTo(Point(-1e9, 0.0));
+        w.lineTo(Point(1e9, 0.0));
+        w.moveTo(Point(0.0, -1e9));
+        w.lineTo(Point(0.0, -2e9));
+    }
+
+    // beyond the range of int once scaled: clipped before truncation
+    for (double smooth : {0.0, 1.0}) {
+        stringstream in(s.str());
+        HeadlessWindow w(32 * 3, 24 * 3);
+        w.smooth(smooth);
+        Reader(in).replay(&w, 3);
+
+        // anti-aliased, the line is half on row 35 and half on row 36
+        auto covered = [&w](int x, int y) {
+            return w.canvas().pixel(x, y).r > 0;
+        };
+        ASSERT_TRUE(covered(0, 36));
+        ASSERT_TRUE(covered(95, 36));
+        ASSERT_FALSE(covered(48, 71));
+    }
+}
+
+TEST(Journal, fillsAndClears) {
+    stringstream s;
+    {
+        Writer w(s, 32, 24);
+        w.moveTo(Point(5, 5));
+        w.clear();
+        Path square(Point(-4, -4));
+        square.push_back(Point(4, -4))
+            .push_back(Point(4, 4))
+            .push_back(Point(-4, 4));
+        w.polygon(square, Color(0, 0, 255));
+        w.moveTo(Point(8, -13));
+        w.lineTo(Point(8, 13));
+        w.fill(Point(12, 0));
+    }
+
+    stringstream in(s.str());
+    HeadlessWindow w(32, 24);
+    Reader(in).replay(&w, 1);
+
+    ASSERT_EQ(255, w.canvas().pixel(16, 12).b);
+    ASSERT_EQ(0, w.canvas().pixel(16, 12).r);
+    ASSERT_TRUE(lit(w, 24, 12));  // the line
+    ASSERT_TRUE(lit(w, 30, 3));   // filled right of it
+    ASSERT_FALSE(lit(w, 2, 3));
+}
+
+TEST(Journal, rejectsMalformed) {
+    stringstream notJournal("P6\n");
+    ASSERT_THROW(Reader r(notJournal), runtime_error);
+
+    stringstream s;
+    Writer(s, 32, 24).lineTo(Point(1000, 1000));
+    auto data = s.str();
+
+    stringstream truncated(data.substr(0, data.size() - 1));
+    HeadlessWindow w(32, 24);
+    ASSERT_THROW(Reader(truncated).replay(&w, 1), runtime_error);
+
+    stringstream invalid(data + char(42));
+    ASSERT_THROW(Reader(invalid).replay(&w, 1), runtime_error);
+}
+
+TEST(Journal, tiledIsTheWholeCanvas) {
+    stringstream s;
+    {
+        Writer w(s, 32, 24);
+        w.moveTo(Point(-20, -20));
+        w.lineTo(Point(20, 15));  // across many tiles, off the image
+        w.clear();
+        w.moveTo(Point(-15, -11));
+        w.lineTo(Point(15, 11));
+        w.lineTo(Point(15, -11));
+        w.moveTo(Point(-3, 2));
+        w.lineTo(Point(-3.0, 2.5));
+        Path triangle(Point(-12, 10));
+        triangle.push_back(Point(0, -10)).push_back(Point(12, 10));
+        w.polygon(triangle, Color(0, 255, 0));
+        w.lineTo(Point(-15, 11));  // from the pen, over the polygon
+    }
+
+    stringstream in(s.str());
+    Reader reader(in);
+    auto drawing = reader.read();
+    ASSERT_EQ(32, drawing.width);
+    ASSERT_EQ(10u, drawing.records.size());
+    ASSERT_FALSE(drawing.has(mlogo::journal::Op::FILL));
+
+    for (double smooth : {0.0, 1.0, 2.5}) {
+        for (double scale : {1.0, 2.5, 3.3}) {
+            stringstream whole(s.str());
+            HeadlessWindow w(32 * scale, 24 * scale);
+            w.smooth(smooth);
+            Reader(whole).replay(&w, scale);
+            stringstream expected;
+            w.canvas().writePPM(expected);
+
+            for (int tile : {7, 16, 100}) {
+                for (unsigned threads : {1u, 3u}) {
+                    stringstream tiled;
+                    mlogo::journal::renderTiled(drawing, scale, tile, threads,
+                                                tiled, smooth);
+                    ASSERT_EQ(expected.str(), tiled.str())
+                        << "smooth " << smooth << ", scale " << scale
+                        << ", tile " << tile;
+                }
+            }
+        }
+    }
+
+    // anti-aliased lines at odd angles, off the grid, across many tiles
+    stringstream lines;
+    {
+        Writer w(lines, 160, 120);
+        srand(3);
+        auto random = [](double range) {
+            return rand() * range / RAND_MAX - range / 2;
+        };
+        for (int i = 0; i < 300; ++i) {
+            w.moveTo(Point(random(170), random(130)));
+            w.lineTo(Point(random(170), random(130)));
+        }
+    }
+    stringstream in2(lines.str());
+    auto many = Reader(in2).read();
+    for (double smooth : {1.0, 3.0}) {
+        stringstream whole(lines.str());
+        HeadlessWindow w(160 * 3.3, 120 * 3.3);
+        w.smooth(smooth);
+        Reader(whole).replay(&w, 3.3);
+        stringstream expected, tiled;
+        w.canvas().writePPM(expected);
+
+        mlogo::journal::renderTiled(many, 3.3, 64, 2, tiled, smooth);
+        ASSERT_EQ(expected.str(), tiled.str()) << "smooth " << smooth;
+    }
+
+    stringstream withFill;
+    Writer(withFill, 32, 24).fill(Point(0, 0));
+    ASSERT_THROW(mlogo::journal::renderTiled(Reader(withFill).read(), 1, 16,
+                                             1, s),
+                 logic_error);
+}
+
+TEST(Journal, offscreenWindowsIgnoreTheEnvironment) {
+    string filename = testing::TempDir() + "mlogo_offscreen.ppm";
+    setenv("MLOGO_SNAPSHOT", filename.c_str(), 1);
+    setenv("MLOGO_ANTIALIAS", "3", 1);
+
+    stringstream s;
+    {
+        Writer w(s, 32, 24);
+        w.moveTo(Point(-10, 0));
+        w.lineTo(Point(10, 0));
+    }
+    auto w = make_unique<HeadlessWindow>(32, 24);
+    stringstream in(s.str());
+    Reader(in).replay(w.get(), 1);
+    auto canvas = w->canvas();
+    w.reset();
+    unsetenv("MLOGO_SNAPSHOT");
+    unsetenv("MLOGO_ANTIALIAS");
+
+    // one pixel wide, not anti-aliased, and not saved
+    ASSERT_EQ(255, canvas.pixel(16, 12).r);
+    ASSERT_EQ(0, canvas.pixel(16, 11).r);
+    ASSERT_EQ(0, canvas.pixel(16, 13).r);
+    ASSERT_FALSE(ifstream(filename).good());
+}
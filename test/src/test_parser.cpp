@@ -86,6 +86,8 @@ TEST(Parser, parseProcName) {
     ASSERT_EQ(ProcName("h45.32"), f("h45.32"));
     ASSERT_EQ(ProcName("c1c"), f("c1c"));
     ASSERT_EQ(ProcName("Ob.1c.2d"), f("Ob.1c.2d"));
+    ASSERT_EQ(ProcName(".stats"), f(".stats"));
+    ASSERT_EQ(ProcName(".STATS.RESET"), f(".STATS.RESET"));
 
     ASSERT_ANY_THROW(f("1c"));
     ASSERT_ANY_THROW(f(":hello"));
@@ -96,6 +98,8 @@ TEST(Parser, parseProcName) {
     ASSERT_ANY_THROW(f("33.a"));
     ASSERT_ANY_THROW(f("33.a34"));
     ASSERT_ANY_THROW(f("33.34a"));
+    ASSERT_ANY_THROW(f(".5"));
+    ASSERT_ANY_THROW(f("..a"));
 }
 
 TEST(Parser, parseExpr) {
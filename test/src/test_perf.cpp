@@ -0,0 +1,56 @@
+/**
+ * @file: test_perf.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <stdexcept>
+
+#include "perf.hpp"
+
+using Counters = mlogo::perf::Counters;
+using Phase = mlogo::perf::Phase;
+using Event = mlogo::perf::Event;
+using PhaseScope = mlogo::perf::PhaseScope;
+
+TEST(Perf, inactiveScopesAreIgnored) {
+    auto &counters = Counters::instance();
+    counters.stop();
+    counters.reset();
+
+    { PhaseScope scope(Phase::PARSE); }
+
+    ASSERT_EQ(0u, counters.metrics(Phase::PARSE).calls);
+}
+
+TEST(Perf, exclusivePhases) {
+    auto &counters = Counters::instance();
+    counters.reset();
+
+    try {
+        counters.start();
+    } catch (std::logic_error &e) {
+        return;  // no PMU available on this host
+    }
+
+    {
+        PhaseScope eval(Phase::EVAL);
+        for (volatile int i = 0; i < 100000; ++i) {
+        }
+
+        PhaseScope render(Phase::RENDER);
+        for (volatile int i = 0; i < 100000; ++i) {
+        }
+    }
+    counters.stop();
+
+    ASSERT_EQ(1u, counters.metrics(Phase::EVAL).calls);
+    ASSERT_EQ(1u, counters.metrics(Phase::RENDER).calls);
+    ASSERT_LT(0u, counters.metrics(Phase::EVAL)[Event::CYCLES]);
+    ASSERT_LT(0u, counters.metrics(Phase::RENDER)[Event::CYCLES]);
+
+    std::stringstream ss;
+    counters.report(ss);
+    ASSERT_NE(std::string::npos, ss.str().find("render"));
+}
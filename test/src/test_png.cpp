@@ -0,0 +1,382 @@
+/**
+ * @file: test_png.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "png.hpp"
+#include "raster.hpp"
+
+using namespace std;
+
+using Canvas = mlogo::graphics::raster::Canvas;
+using Color = mlogo::graphics::Color;
+using Level = mlogo::png::Level;
+
+namespace {
+
+uint32_t bigEndian(const string &s, size_t at) {
+    uint32_t v = 0;
+    for (size_t i = at; i < at + 4; ++i) v = v << 8 | uint8_t(s[i]);
+    return v;
+}
+
+uint32_t crc32(const string &s) {
+    uint32_t crc = ~0u;
+    for (auto c : s) {
+        crc ^= uint8_t(c);
+        for (int k = 0; k < 8; ++k)
+            crc = crc & 1 ? 0xedb88320 ^ crc >> 1 : crc >> 1;
+    }
+    return ~crc;
+}
+
+uint32_t adler32(const string &s) {
+    uint32_t a = 1, b = 0;
+    for (auto c : s) {
+        a = (a + uint8_t(c)) % 65521;
+        b = (b + a) % 65521;
+    }
+    return b << 16 | a;
+}
+
+/// Deflate decoder after zlib's puff: slow, small and strict.
+class Inflater {
+public:
+    explicit Inflater(const string &in) : _in(in) {}
+
+    string inflate() {
+        string out;
+        for (bool last = false; !last;) {
+            last = bits(1);
+            switch (bits(2)) {
+            case 0:
+                stored(out);
+                break;
+            case 1:
+                fixed(out);
+                break;
+            case 2:
+                dynamic(out);
+                break;
+            default:
+                throw runtime_error("Invalid block type");
+            }
+        }
+        return out;
+    }
+
+    /// Bytes read, the last one whole.
+    size_t position() const { return _position; }
+
+private:
+    struct Huffman {
+        vector<int> count, symbol;
+    };
+
+    int bits(int n) {
+        int v = 0;
+        for (int i = 0; i < n; ++i) {
+            if (!_count) {
+                if (_position == _in.size()) throw runtime_error("Truncated");
+                _byte = uint8_t(_in[_position++]);
+                _count = 8;
+            }
+            v |= (_byte & 1) << i;
+            _byte >>= 1;
+            --_count;
+        }
+        return v;
+    }
+
+    static Huffman code(const int *lengths, int n) {
+        Huffman h{vector<int>(16, 0), vector<int>(n, 0)};
+        for (int s = 0; s < n; ++s) ++h.count[lengths[s]];
+
+        int left = 1;
+        for (int l = 1; l < 16; ++l) {
+            left = 2 * left - h.count[l];
+            if (left < 0) throw runtime_error("Oversubscribed code");
+        }
+
+        vector<int> offsets(16, 0);
+        for (int l = 1; l < 15; ++l) offsets[l + 1] = offsets[l] + h.count[l];
+        for (int s = 0; s < n; ++s)
+            if (lengths[s]) h.symbol[offsets[lengths[s]]++] = s;
+        return h;
+    }
+
+    int decode(const Huffman &h) {
+        int code = 0, first = 0, index = 0;
+        for (int l = 1; l < 16; ++l) {
+            code |= bits(1);
+            int count = h.count[l];
+            if (code - count < first) return h.symbol[index + code - first];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        throw runtime_error("Invalid code");
+    }
+
+    void stored(string &out) {
+        _count = 0;
+        auto length = bits(16), complement = bits(16);
+        if (length != (~complement & 0xffff))
+            throw runtime_error("Invalid stored length");
+        for (int i = 0; i < length; ++i) out.push_back(char(bits(8)));
+    }
+
+    void fixed(string &out) {
+        int lengths[288];
+        for (int s = 0; s < 288; ++s)
+            lengths[s] = s < 144 ? 8 : s < 256 ? 9 : s < 280 ? 7 : 8;
+        auto literals = code(lengths, 288);
+        for (int s = 0; s < 30; ++s) lengths[s] = 5;
+        symbols(out, literals, code(lengths, 30));
+    }
+
+    void dynamic(string &out) {
+        static const int ORDER[]{16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                 11, 4,  12, 3, 13, 2, 14, 1, 15};
+        int nLiterals = bits(5) + 257, nDistances = bits(5) + 1;
+        int nCodes = bits(4) + 4;
+
+        int lengths[320] = {0};
+        for (int i = 0; i < nCodes; ++i) lengths[ORDER[i]] = bits(3);
+        auto lengthCode = code(lengths, 19);
+
+        for (int i = 0; i < nLiterals + nDistances;) {
+            int s = decode(lengthCode);
+            if (s < 16) {
+                lengths[i++] = s;
+                continue;
+            }
+
+            int l = 0, repeat;
+            if (s == 16) {
+                if (!i) throw runtime_error("Nothing to repeat");
+                l = lengths[i - 1];
+                repeat = 3 + bits(2);
+            } else {
+                repeat = s == 17 ? 3 + bits(3) : 11 + bits(7);
+            }
+            if (i + repeat > nLiterals + nDistances)
+                throw runtime_error("Too many lengths");
+            while (repeat--) lengths[i++] = l;
+        }
+
+        symbols(out, code(lengths, nLiterals),
+                code(lengths + nLiterals, nDistances));
+    }
+
+    void symbols(string &out, const Huffman &literals,
+                 const Huffman &distances) {
+        static const int BASE[]{3,  4,  5,  6,  7,  8,  9,   10,  11,  13,
+                                15, 17, 19, 23, 27, 31, 35,  43,  51,  59,
+                                67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const int EXTRA[]{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const int DISTANCE[]{
+            1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+            33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
+            1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        static const int DISTANCE_EXTRA[]{0, 0, 0,  0,  1,  1,  2,  2,
+                                          3, 3, 4,  4,  5,  5,  6,  6,
+                                          7, 7, 8,  8,  9,  9,  10, 10,
+                                          11, 11, 12, 12, 13, 13};
+
+        for (;;) {
+            int s = decode(literals);
+            if (s < 256) {
+                out.push_back(char(s));
+                continue;
+            }
+            if (s == 256) return;
+
+            s -= 257;
+            if (s >= 29) throw runtime_error("Invalid length");
+            int length = BASE[s] + bits(EXTRA[s]);
+            int d = decode(distances);
+            if (d >= 30) throw runtime_error("Invalid distance");
+            size_t distance = DISTANCE[d] + bits(DISTANCE_EXTRA[d]);
+            if (distance > out.size()) throw runtime_error("Too far back");
+            while (length--) out.push_back(out[out.size() - distance]);
+        }
+    }
+
+    const string &_in;
+    size_t _position{0};
+    int _byte{0}, _count{0};
+};
+
+/// Decode png, checking every chunk, into the pixels of an RGB image.
+string decode(const string &png, int &width, int &height) {
+    if (png.compare(0, 8, "\x89PNG\r\n\x1a\n") != 0)
+        throw runtime_error("Not a PNG");
+
+    string zlib;
+    for (size_t at = 8; at < png.size();) {
+        auto length = bigEndian(png, at);
+        auto chunk = png.substr(at + 4, length + 4);
+        if (crc32(chunk) != bigEndian(png, at + 8 + length))
+            throw runtime_error("Invalid CRC");
+
+        auto type = chunk.substr(0, 4);
+        if (type == "IHDR") {
+            width = bigEndian(chunk, 4);
+            height = bigEndian(chunk, 8);
+            if (chunk.substr(12) != string("\x08\x02\0\0\0", 5))
+                throw runtime_error("Not 8 bit RGB");
+        } else if (type == "IDAT") {
+            zlib += chunk.substr(4);
+        }
+        at += 12 + length;
+    }
+
+    if ((uint8_t(zlib[0]) * 256 + uint8_t(zlib[1])) % 31 ||
+        (zlib[0] & 15) != 8)
+        throw runtime_error("Invalid zlib header");
+
+    auto deflated = zlib.substr(2);
+    Inflater inflater(deflated);
+    auto filtered = inflater.inflate();
+    if (inflater.position() + 4 != deflated.size() ||
+        adler32(filtered) != bigEndian(deflated, inflater.position()))
+        throw runtime_error("Invalid Adler-32");
+
+    // undo the filters
+    size_t stride = size_t(width) * 3;
+    if (filtered.size() != (stride + 1) * height)
+        throw runtime_error("Invalid image size");
+    string rgb, prior(stride, 0);
+    for (int y = 0; y < height; ++y) {
+        auto type = filtered[y * (stride + 1)];
+        auto row = filtered.substr(y * (stride + 1) + 1, stride);
+        for (size_t i = 0; i < stride; ++i) {
+            int a = i >= 3 ? uint8_t(row[i - 3]) : 0, b = uint8_t(prior[i]);
+            int c = i >= 3 ? uint8_t(prior[i - 3]) : 0, p = a + b - c;
+            int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+            int predictors[]{0, a, b, (a + b) / 2,
+                             pa <= pb && pa <= pc ? a : pb <= pc ? b : c};
+            row[i] = char(row[i] + predictors[int(type)]);
+        }
+        rgb += row;
+        prior = row;
+    }
+    return rgb;
+}
+
+string rgb(const Canvas &canvas) {
+    string out;
+    auto p = canvas.data();
+    for (int i = 0; i < canvas.width() * canvas.height(); ++i) {
+        out.push_back(char(p[i] >> 24));
+        out.push_back(char(p[i] >> 16));
+        out.push_back(char(p[i] >> 8));
+    }
+    return out;
+}
+
+/// Lines over a dark background, and a band of noise that does not
+/// compress.
+Canvas drawing(int width, int height) {
+    Canvas canvas(width, height);
+    canvas.fill(Color(0, 0, 32));
+    srand(7);
+    for (int i = 0; i < 400; ++i) {
+        double x = rand() % width, y = rand() % height;
+        canvas.smoothLine(x, y, x + rand() % 80 - 40, y + rand() % 80 - 40, 2,
+                          Color(rand() % 256, 255, rand() % 256));
+    }
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width / 8; ++x)
+            canvas.pixel(x, y, Color(rand() % 256, rand() % 256, rand() % 256));
+    return canvas;
+}
+
+}  // namespace
+
+TEST(Png, levels) {
+    ASSERT_EQ(Level::STORE, mlogo::png::level("store"));
+    ASSERT_EQ(Level::FAST, mlogo::png::level("FAST"));
+    ASSERT_EQ(Level::BEST, mlogo::png::level("Best"));
+    ASSERT_STREQ("best", mlogo::png::name(Level::BEST));
+    ASSERT_THROW(mlogo::png::level("zip"), logic_error);
+}
+
+TEST(Png, decodesToTheCanvas) {
+    // taller than a stripe, so that several are deflated and joined
+    auto canvas = drawing(640, 700);
+    auto pixels = rgb(canvas);
+
+    string sizes[3];
+    for (auto level : {Level::STORE, Level::FAST, Level::BEST}) {
+        string first;
+        for (unsigned threads : {1u, 3u}) {
+            stringstream s;
+            mlogo::png::write(s, canvas, level, threads);
+
+            int width = 0, height = 0;
+            ASSERT_EQ(pixels, decode(s.str(), width, height))
+                << mlogo::png::name(level) << ", " << threads << " threads";
+            ASSERT_EQ(640, width);
+            ASSERT_EQ(700, height);
+
+            // the stripes do not depend on the threads
+            if (first.empty()) first = s.str();
+            ASSERT_EQ(first, s.str());
+        }
+        sizes[int(level)] = first;
+    }
+
+    ASSERT_GT(sizes[0].size(), pixels.size());
+    ASSERT_LT(sizes[1].size(), sizes[0].size() / 2);
+    ASSERT_LE(sizes[2].size(), sizes[1].size());
+}
+
+TEST(Png, bestIsNeverLargerThanFast) {
+    // noise moved 7 pixels a row: Up keeps the matches between rows,
+    // filters chosen row by row break them
+    vector<int> noise(4096);
+    srand(263);
+    for (auto &v : noise) v = rand() % 256;
+    Canvas canvas(256, 256);
+    for (int y = 0; y < canvas.height(); ++y)
+        for (int x = 0; x < canvas.width(); ++x) {
+            int v = noise[(x + 7 * y) % noise.size()];
+            canvas.pixel(x, y, Color(v, v, v));
+        }
+
+    stringstream fast, best;
+    mlogo::png::write(fast, canvas, Level::FAST, 1);
+    mlogo::png::write(best, canvas, Level::BEST, 1);
+    ASSERT_LE(best.str().size(), fast.str().size());
+
+    int width = 0, height = 0;
+    ASSERT_EQ(rgb(canvas), decode(best.str(), width, height));
+}
+
+TEST(Png, smallPictures) {
+    for (int width : {1, 2, 5}) {
+        Canvas canvas(width, 1);
+        canvas.fill(Color(1, 2, 3));
+        for (auto level : {Level::STORE, Level::FAST, Level::BEST}) {
+            stringstream s;
+            mlogo::png::write(s, canvas, level);
+
+            int w = 0, h = 0;
+            ASSERT_EQ(rgb(canvas), decode(s.str(), w, h));
+        }
+    }
+
+    stringstream s;
+    ASSERT_THROW(mlogo::png::write(s, Canvas(0, 0)), logic_error);
+}
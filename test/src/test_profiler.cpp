@@ -0,0 +1,65 @@
+/**
+ * @file: test_profiler.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "profiler.hpp"
+
+using Sampler = mlogo::profiler::Sampler;
+
+TEST(Profiler, foldedStacks) {
+    auto &sampler = Sampler::instance();
+    sampler.reset();
+
+    sampler.sample();
+    sampler.enter("square");
+    sampler.enter("REPEAT");
+    sampler.enter("fd");
+    sampler.sample();
+    sampler.sample();
+    sampler.leave();
+    sampler.enter("RT");
+    sampler.sample();
+    sampler.leave();
+    sampler.leave();
+    sampler.leave();
+
+    auto folded = sampler.folded();
+    ASSERT_EQ(3u, folded.size());
+    ASSERT_EQ(1u, folded.at("(toplevel)"));
+    ASSERT_EQ(2u, folded.at("square;repeat;fd"));
+    ASSERT_EQ(1u, folded.at("square;repeat;rt"));
+    ASSERT_EQ(0u, sampler.dropped());
+}
+
+TEST(Profiler, deepStacksAreTruncated) {
+    auto &sampler = Sampler::instance();
+    sampler.reset();
+
+    for (std::size_t i = 0; i < Sampler::MAX_DEPTH + 2; ++i)
+        sampler.enter("rec");
+    sampler.sample();
+    for (std::size_t i = 0; i < Sampler::MAX_DEPTH + 2; ++i) sampler.leave();
+
+    auto folded = sampler.folded();
+    ASSERT_EQ(1u, folded.size());
+
+    auto stack = folded.begin()->first;
+    ASSERT_EQ(";...", stack.substr(stack.size() - 4));
+    ASSERT_EQ(Sampler::MAX_DEPTH, std::count(stack.begin(), stack.end(), ';'));
+}
+
+TEST(Profiler, fullRingDropsSamples) {
+    auto &sampler = Sampler::instance();
+    sampler.reset();
+
+    sampler.enter("busy");
+    for (std::size_t i = 0; i < Sampler::CAPACITY + 10; ++i) sampler.sample();
+    sampler.leave();
+
+    ASSERT_EQ(10u, sampler.dropped());
+    ASSERT_EQ(Sampler::CAPACITY, sampler.folded().at("busy"));
+}
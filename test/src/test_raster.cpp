@@ -0,0 +1,234 @@
+/**
+ * @file: test_raster.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#include "raster.hpp"
+
+using Canvas = mlogo::graphics::raster::Canvas;
+using Spans = mlogo::graphics::raster::Spans;
+using Color = mlogo::graphics::Color;
+using Path = mlogo::geometry::Path;
+using Point = mlogo::geometry::Point;
+
+namespace {
+
+bool lit(const Canvas &c, int x, int y) { return c.pixel(x, y).r == 255; }
+
+int count(const Spans &spans) {
+    int n{0};
+    for (const auto &s : spans) n += s.x1 - s.x0 + 1;
+    return n;
+}
+
+}  // namespace
+
+TEST(Raster, fill) {
+    Canvas c(4, 3);
+    c.fill(Color(1, 2, 3));
+
+    auto p = c.pixel(3, 2);
+    ASSERT_EQ(1, p.r);
+    ASSERT_EQ(2, p.g);
+    ASSERT_EQ(3, p.b);
+    ASSERT_EQ(Color::NO_ALPHA, p.a);
+    ASSERT_EQ(0, c.pixel(4, 2).a);  // out of bounds
+}
+
+TEST(Raster, lineIncludesEndPoints) {
+    Canvas c(10, 10);
+    c.fill(Color(0, 0, 0));
+    c.line(1, 1, 8, 4, Color(255, 255, 255));
+
+    ASSERT_TRUE(lit(c, 1, 1));
+    ASSERT_TRUE(lit(c, 8, 4));
+    ASSERT_FALSE(lit(c, 8, 8));
+
+    int count{0};
+    for (int y = 0; y < 10; ++y)
+        for (int x = 0; x < 10; ++x) count += lit(c, x, y);
+    ASSERT_EQ(8, count);  // one pixel per column
+}
+
+TEST(Raster, lineOutsideIsClipped) {
+    Canvas c(10, 10);
+    c.fill(Color(0, 0, 0));
+    ASSERT_NO_THROW(c.line(-5, 5, 15, 5, Color(255, 255, 255)));
+
+    ASSERT_TRUE(lit(c, 0, 5));
+    ASSERT_TRUE(lit(c, 9, 5));
+}
+
+TEST(Raster, smoothLineCoverage) {
+    Canvas c(12, 12);
+    c.fill(Color(0, 0, 0));
+
+    // along the centers of row 5, one pixel wide
+    c.smoothLine(2, 5.5, 9, 5.5, 1, Color(255, 255, 255));
+    ASSERT_EQ(255, c.pixel(5, 5).r);
+    ASSERT_EQ(0, c.pixel(5, 4).r);
+    ASSERT_EQ(0, c.pixel(5, 6).r);
+    ASSERT_EQ(Color::NO_ALPHA, c.pixel(5, 5).a);
+
+    // between rows, half of each
+    c.fill(Color(0, 0, 0));
+    c.smoothLine(2, 5, 9, 5, 1, Color(255, 255, 255));
+    ASSERT_EQ(128, c.pixel(5, 4).r);
+    ASSERT_EQ(128, c.pixel(5, 5).r);
+
+    // wider, and blended
+    c.fill(Color(0, 0, 0));
+    c.smoothLine(2, 5.5, 9, 5.5, 3, Color(0, 0, 255, 128));
+    for (int y : {4, 5, 6}) ASSERT_EQ(128, c.pixel(5, y).b);
+    ASSERT_EQ(0, c.pixel(5, 3).b);
+    ASSERT_EQ(0, c.pixel(5, 5).r);
+
+    // round caps, 1.5 around the ends
+    ASSERT_EQ(128, c.pixel(1, 5).b);
+    ASSERT_EQ(64, c.pixel(0, 5).b);
+    ASSERT_EQ(0, c.pixel(0, 3).b);
+}
+
+TEST(Raster, smoothLineFarAway) {
+    Canvas c(100, 100);
+    c.fill(Color(0, 0, 0));
+
+    // bounds beyond the range of int: nothing to draw
+    c.smoothLine(50, 5e9, 50, 6e9, 1, Color(255, 255, 255));
+    c.smoothLine(-6e9, -5e9, -5e9, 6e9, 3, Color(255, 255, 255));
+    for (int y = 0; y < 100; ++y)
+        for (int x = 0; x < 100; ++x) ASSERT_EQ(0, c.pixel(x, y).r);
+
+    // across the canvas, from far away
+    c.smoothLine(50.5, -5e9, 50.5, 5e9, 1, Color(255, 255, 255));
+    ASSERT_EQ(255, c.pixel(50, 0).r);
+    ASSERT_EQ(255, c.pixel(50, 99).r);
+    ASSERT_EQ(0, c.pixel(49, 50).r);
+}
+
+TEST(Raster, smoothLineMatchesScalar) {
+    srand(7);
+    auto random = [](double range) { return rand() * range / RAND_MAX; };
+
+    Canvas vector(67, 45), scalar(67, 45);
+    for (int i = 0; i < 500; ++i) {
+        double x0 = random(90) - 10, y0 = random(70) - 10;
+        double x1 = random(90) - 10, y1 = random(70) - 10;
+        double width = random(6);
+        Color color(rand() % 256, rand() % 256, rand() % 256, rand() % 256);
+
+        vector.smoothLine(x0, y0, x1, y1, width, color);
+        scalar.smoothLineScalar(x0, y0, x1, y1, width, color);
+    }
+
+    // the same float arithmetic: at most a rounding apart
+    for (int y = 0; y < 45; ++y) {
+        for (int x = 0; x < 67; ++x) {
+            auto v = vector.pixel(x, y), s = scalar.pixel(x, y);
+            ASSERT_LE(abs(v.r - s.r), 1);
+            ASSERT_LE(abs(v.g - s.g), 1);
+            ASSERT_LE(abs(v.b - s.b), 1);
+            ASSERT_LE(abs(v.a - s.a), 1);
+        }
+    }
+}
+
+TEST(Raster, ppm) {
+    Canvas c(2, 2);
+    c.fill(Color(255, 0, 0));
+
+    std::stringstream ss;
+    c.writePPM(ss);
+
+    std::string header = "P6\n2 2\n255\n";
+    auto out = ss.str();
+    ASSERT_EQ(header.size() + 12, out.size());
+    ASSERT_EQ(header, out.substr(0, header.size()));
+    ASSERT_EQ('\xff', out[header.size()]);
+    ASSERT_EQ('\0', out[header.size() + 1]);
+}
+
+TEST(Raster, floodStopsAtBorders) {
+    Canvas c(10, 10);
+    c.fill(Color(0, 0, 0));
+    // a closed square, and a gap in the one around it
+    c.line(2, 2, 6, 2, Color(255, 255, 255));
+    c.line(6, 2, 6, 6, Color(255, 255, 255));
+    c.line(6, 6, 2, 6, Color(255, 255, 255));
+    c.line(2, 6, 2, 2, Color(255, 255, 255));
+
+    Spans spans;
+    mlogo::graphics::raster::floodSpans(c, 4, 4, spans);
+    ASSERT_EQ(3u, spans.size());
+    ASSERT_EQ(9, count(spans));
+
+    c.fill(spans, Color(255, 0, 0));
+    ASSERT_TRUE(lit(c, 3, 3));
+    ASSERT_TRUE(lit(c, 5, 5));
+    ASSERT_EQ(0, c.pixel(1, 1).r);
+
+    // the outside, around the square: 100 - 25
+    mlogo::graphics::raster::floodSpans(c, 0, 0, spans);
+    ASSERT_EQ(75, count(spans));
+
+    // nothing is left marked by the previous call
+    mlogo::graphics::raster::floodSpans(c, 0, 0, spans);
+    ASSERT_EQ(75, count(spans));
+
+    mlogo::graphics::raster::floodSpans(c, -1, 0, spans);
+    ASSERT_TRUE(spans.empty());
+}
+
+TEST(Raster, floodFollowsConcaveAreas) {
+    // a U: the flood must go down one arm and up the other
+    Canvas c(5, 4);
+    c.fill(Color(0, 0, 0));
+    c.line(2, 0, 2, 2, Color(255, 255, 255));
+
+    Spans spans;
+    mlogo::graphics::raster::floodSpans(c, 0, 0, spans);
+    ASSERT_EQ(17, count(spans));
+}
+
+TEST(Raster, polygonCoversPixelCenters) {
+    Path square{Point(1.0, 1.0)};
+    square.push_back(Point(5.0, 1.0)).push_back(Point(5.0, 4.0));
+    square.push_back(Point(1.0, 4.0));
+
+    Spans spans;
+    mlogo::graphics::raster::polygonSpans(square, 10, 10, spans);
+    ASSERT_EQ(3u, spans.size());
+    ASSERT_EQ(12, count(spans));
+    ASSERT_EQ(1, spans[0].x0);
+    ASSERT_EQ(4, spans[0].x1);
+    ASSERT_EQ(1, spans[0].y);
+
+    // clipped to the canvas
+    Path big{Point(-10.0, -10.0)};
+    big.push_back(Point(20.0, -10.0)).push_back(Point(20.0, 20.0));
+    big.push_back(Point(-10.0, 20.0));
+    mlogo::graphics::raster::polygonSpans(big, 10, 10, spans);
+    ASSERT_EQ(100, count(spans));
+}
+
+TEST(Raster, polygonEvenOdd) {
+    // a pentagram: its center is outside by the even-odd rule
+    Path star{Point(50.0, 0.0)};
+    star.push_back(Point(79.0, 90.0)).push_back(Point(2.0, 35.0));
+    star.push_back(Point(98.0, 35.0)).push_back(Point(21.0, 90.0));
+
+    Spans spans;
+    mlogo::graphics::raster::polygonSpans(star, 100, 100, spans);
+
+    Canvas c(100, 100);
+    c.fill(Color(0, 0, 0));
+    c.fill(spans, Color(255, 255, 255));
+    ASSERT_TRUE(lit(c, 50, 10));  // a point of the star
+    ASSERT_FALSE(lit(c, 50, 50));
+    ASSERT_FALSE(lit(c, 5, 80));
+}
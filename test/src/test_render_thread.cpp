@@ -0,0 +1,338 @@
+/**
+ * @file: test_render_thread.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "geometry.hpp"
+#include "raster.hpp"
+#include "render_thread.hpp"
+#include "spsc_queue.hpp"
+
+using namespace mlogo;
+using namespace mlogo::graphics;
+using mlogo::geometry::Path;
+using mlogo::geometry::Point;
+using mlogo::geometry::Scene;
+
+namespace {
+
+/// Window recording what the render thread asks it to do.
+struct RecordingWindow : Window {
+    using Window::draw;
+
+    Window *background(const Color &) override { return this; }
+    Window *foreground(const Color &) override { return this; }
+    Window *clear() override {
+        ++clears;
+        return this;
+    }
+    Window *draw(const Path &path, std::size_t first) override {
+        ++draws;
+        segments += path.size() - first - 1;
+        last = path.last().x;
+        return this;
+    }
+    Window *sprites(const Scene &sprites) override {
+        spritePoints = sprites.size();
+        spritePaths = sprites.paths();
+        return this;
+    }
+    Window *hideSprite() override {
+        spritePoints = 0;
+        return this;
+    }
+    Window *setColor(const Color &) override { return this; }
+    Window *fill(const Point &seed) override {
+        ++fills;
+        last = seed.x;
+        return this;
+    }
+    Window *fillPolygon(const Path &polygon, const Color &c) override {
+        ++fills;
+        polygonPoints = polygon.size();
+        fillColor = c.g;
+        return this;
+    }
+    Window *paint() override {
+        ++paints;
+        return this;
+    }
+    const raster::Canvas &picture() override {
+        ++pictures;
+        pictureThread = std::this_thread::get_id();
+        return canvas;
+    }
+
+    int clears{0}, draws{0}, paints{0}, fills{0}, pictures{0};
+    raster::Canvas canvas{4, 3};
+    std::thread::id pictureThread;
+    std::size_t segments{0}, spritePoints{0}, spritePaths{0};
+    std::size_t polygonPoints{0};
+    int fillColor{0};
+    double last{0};
+};
+
+}  // namespace
+
+TEST(SpscQueue, fullAndEmpty) {
+    SpscQueue<int> q(3);
+    ASSERT_EQ(4u, q.capacity());
+    ASSERT_TRUE(q.empty());
+
+    for (int i = 0; i < 4; ++i) ASSERT_TRUE(q.push(i));
+    ASSERT_FALSE(q.push(4));
+
+    int v;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(q.pop(v));
+        ASSERT_EQ(i, v);
+    }
+    ASSERT_FALSE(q.pop(v));
+    ASSERT_TRUE(q.empty());
+}
+
+TEST(SpscQueue, keepsOrderAcrossThreads) {
+    static constexpr int N{100000};
+    SpscQueue<int> q(64);
+
+    std::thread producer([&q]() {
+        for (int i = 0; i < N; ++i)
+            while (!q.push(i)) std::this_thread::yield();
+    });
+
+    int expected{0}, v;
+    while (expected < N) {
+        if (q.pop(v)) {
+            ASSERT_EQ(expected++, v);
+        }
+    }
+    producer.join();
+}
+
+TEST(RenderThread, batchesSegments) {
+    auto recorder = new RecordingWindow;
+    RenderThread thread([recorder]() { return recorder; });
+    ASSERT_EQ(recorder, thread.target());
+
+    thread.clear();
+
+    // one segment per call, as the turtle sends them
+    Path path{Point(0, 0)};
+    for (int i = 1; i <= 10; ++i) {
+        path.push_back(Point(i, 0));
+        thread.draw(path, i - 1);
+    }
+    thread.paint();
+    thread.sync();
+
+    ASSERT_EQ(1, recorder->clears);
+    ASSERT_EQ(1, recorder->paints);
+    ASSERT_EQ(10u, recorder->segments);
+    ASSERT_GE(10, recorder->draws);
+    ASSERT_DOUBLE_EQ(10, recorder->last);
+
+    thread.sprite(path);
+    thread.sync();
+    ASSERT_EQ(11u, recorder->spritePoints);
+
+    thread.hideSprite();
+    thread.sync();
+    ASSERT_EQ(0u, recorder->spritePoints);
+}
+
+TEST(RenderThread, sendsEverySprite) {
+    auto recorder = new RecordingWindow;
+    RenderThread thread([recorder]() { return recorder; });
+
+    Scene sprites;
+    sprites.moveTo(Point(0, 0)).lineTo(Point(5, 0)).lineTo(Point(0, 5));
+    sprites.moveTo(Point(9, 9)).lineTo(Point(9, 0));
+    thread.sprites(sprites);
+    thread.sync();
+    ASSERT_EQ(5u, recorder->spritePoints);
+    ASSERT_EQ(2u, recorder->spritePaths);
+
+    // a single sprite replaces them
+    Path one{Point(0, 0)};
+    thread.sprite(one.push_back(Point(1, 1)));
+    thread.sync();
+    ASSERT_EQ(2u, recorder->spritePoints);
+    ASSERT_EQ(1u, recorder->spritePaths);
+}
+
+TEST(RenderThread, fills) {
+    auto recorder = new RecordingWindow;
+    RenderThread thread([recorder]() { return recorder; });
+
+    Path triangle{Point(0, 0)};
+    triangle.push_back(Point(10, 0)).push_back(Point(0, 10));
+    thread.fillPolygon(triangle, Color(1, 2, 3));
+    thread.fill(Point(7, 3));
+    thread.sync();
+
+    ASSERT_EQ(2, recorder->fills);
+    ASSERT_EQ(3u, recorder->polygonPoints);
+    ASSERT_EQ(2, recorder->fillColor);
+    ASSERT_DOUBLE_EQ(7, recorder->last);
+}
+
+TEST(RenderThread, picturesAfterDrawing) {
+    auto recorder = new RecordingWindow;
+    RenderThread thread([recorder]() { return recorder; });
+
+    Path path{Point(0, 0)};
+    path.push_back(Point(10, 0));
+    thread.draw(path, 0);
+
+    // the polyline is drawn before the picture is taken, there
+    const auto &picture = thread.picture();
+    ASSERT_EQ(&recorder->canvas, &picture);
+    ASSERT_EQ(1, recorder->pictures);
+    ASSERT_EQ(1, recorder->draws);
+    ASSERT_NE(std::this_thread::get_id(), recorder->pictureThread);
+}
+
+TEST(RenderThread, drawsScene) {
+    auto recorder = new RecordingWindow;
+    RenderThread thread([recorder]() { return recorder; });
+
+    Scene scene;
+    scene.moveTo(Point(0, 0)).lineTo(Point(1, 0)).lineTo(Point(2, 0));
+    scene.moveTo(Point(5, 5));
+    scene.moveTo(Point(0, 5)).lineTo(Point(3, 5));
+
+    thread.draw(scene, 0);
+    thread.sync();
+    ASSERT_EQ(3u, recorder->segments);
+    ASSERT_DOUBLE_EQ(3, recorder->last);
+
+    // only the segments ending at the new points
+    scene.lineTo(Point(4, 5)).lineTo(Point(7, 5));
+    thread.draw(scene, 6);
+    thread.sync();
+    ASSERT_EQ(5u, recorder->segments);
+    ASSERT_DOUBLE_EQ(7, recorder->last);
+}
+
+TEST(RenderThread, skipsPointsOnSamePixel) {
+    auto recorder = new RecordingWindow;
+    RenderThread thread([recorder]() { return recorder; });
+
+    Path path{Point(0, 0)};
+    path.push_back(Point(0.2, 0.0)).push_back(Point(0.5, 0.3));
+    path.push_back(Point(5, 0));
+    thread.draw(path, 0);
+    thread.sync();
+    ASSERT_EQ(1u, recorder->segments);
+
+    // the last segment is kept even if it is within a pixel
+    Path dot{Point(10, 10)};
+    dot.push_back(Point(10.5, 10.0));
+    thread.draw(dot, 0);
+    thread.sync();
+    ASSERT_EQ(2u, recorder->segments);
+}
+
+TEST(RenderThread, keepsPointsOnSamePixelForAntialiasing) {
+    auto recorder = new RecordingWindow;
+    RenderThread thread([recorder]() { return recorder; }, false);
+
+    Path path{Point(0, 0)};
+    path.push_back(Point(0.2, 0.0)).push_back(Point(0.5, 0.3));
+    path.push_back(Point(5, 0));
+    thread.draw(path, 0);
+    thread.sync();
+    ASSERT_EQ(3u, recorder->segments);
+}
+
+TEST(RenderThread, drawsAsTheWindowItself) {
+    using mlogo::geometry::Reference;
+
+    // a star of spokes, an arc and a line just off a pixel boundary, in
+    // turtle coordinates and magnified by 3
+    for (double zoom : {1.0, 3.0}) {
+        Reference turtle{1 / zoom, 320, -1 / zoom, 240};
+        Scene scene{turtle};
+        scene.moveTo(Point(-1e-5, 10.0, turtle))
+            .lineTo(Point(-1e-5, 60.0, turtle));
+        double x{0}, y{0}, heading{0};
+        scene.moveTo(Point(x, y, turtle));
+        for (int i = 0; i < 36; ++i) {
+            x += 100 / zoom * std::sin(heading);
+            y += 100 / zoom * std::cos(heading);
+            scene.lineTo(Point(x, y, turtle));
+            heading += 170 * M_PI / 180;
+        }
+        scene.moveTo(Point(x + 50, y, turtle));
+        for (int i = 1; i <= 20; ++i)
+            scene.lineTo(Point(x + 50 * std::cos(i * M_PI / 40),
+                               y + 50 * std::sin(i * M_PI / 40), turtle));
+
+        HeadlessWindow direct(640, 480);
+        direct.draw(scene, 0);
+
+        HeadlessWindow *target{nullptr};
+        RenderThread thread([&target]() {
+            return target = new HeadlessWindow(640, 480);
+        });
+        thread.draw(scene, 0);
+        thread.sync();
+
+        const auto &a = direct.canvas(), &b = target->canvas();
+        ASSERT_TRUE(std::equal(a.data(), a.data() + a.width() * a.height(),
+                               b.data()));
+    }
+}
+
+TEST(Window, drawsSceneByPath) {
+    RecordingWindow window;
+
+    Scene scene;
+    scene.moveTo(Point(0, 0)).lineTo(Point(1, 0)).lineTo(Point(2, 0));
+    scene.moveTo(Point(0, 5)).lineTo(Point(3, 5));
+
+    window.draw(scene, 2);
+    ASSERT_EQ(2, window.draws);
+    ASSERT_EQ(2u, window.segments);
+}
+
+TEST(RenderThread, backpressure) {
+    auto recorder = new RecordingWindow;
+    RenderThread thread([recorder]() { return recorder; });
+
+    // more commands than the queue can hold
+    Path path{Point(0, 0)};
+    for (std::size_t i = 1; i <= 2 * RenderThread::QUEUE_SIZE; ++i)
+        path.push_back(Point(int(i % 100), 0));
+    thread.draw(path, 0);
+    thread.sync();
+
+    ASSERT_EQ(2 * RenderThread::QUEUE_SIZE, recorder->segments);
+}
+
+TEST(RenderThread, wakesUpWhenIdle) {
+    auto recorder = new RecordingWindow;
+    RenderThread thread([recorder]() { return recorder; });
+
+    // long enough for the render thread to block between commands
+    for (int i = 1; i <= 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        thread.clear();
+        thread.sync();
+        ASSERT_EQ(i, recorder->clears);
+    }
+}
+
+TEST(RenderThread, factoryErrors) {
+    ASSERT_THROW(RenderThread thread([]() -> Window * {
+        throw std::logic_error("no window");
+    }),
+                 std::logic_error);
+}
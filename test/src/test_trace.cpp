@@ -0,0 +1,67 @@
+/**
+ * @file: test_trace.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "trace.hpp"
+
+using Tracer = mlogo::trace::Tracer;
+using Scope = mlogo::trace::Scope;
+
+namespace {
+
+std::string readAll(const std::string &filename) {
+    std::ifstream in(filename);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+}  // namespace
+
+TEST(Trace, disabledScopeRecordsNothing) {
+    auto &tracer = Tracer::instance();
+    tracer.stop();
+
+    { Scope s("test", "nothing"); }
+
+    ASSERT_FALSE(tracer.enabled());
+    ASSERT_EQ(0u, tracer.pending());
+}
+
+TEST(Trace, scopesAreBufferedAndFlushed) {
+    std::string filename{"mlogo_test_trace.json"};
+    auto &tracer = Tracer::instance();
+
+    tracer.start(filename);
+    ASSERT_TRUE(tracer.enabled());
+
+    {
+        Scope outer("call", "outer");
+        Scope inner("call", "in\"ner");
+    }
+    ASSERT_EQ(2u, tracer.pending());
+
+    tracer.flush();
+    ASSERT_EQ(0u, tracer.pending());
+
+    { Scope last("turtle", "render"); }
+    tracer.stop();
+    ASSERT_FALSE(tracer.enabled());
+
+    auto out = readAll(filename);
+    ASSERT_EQ('[', out.front());
+    ASSERT_NE(std::string::npos, out.find("\"name\":\"outer\""));
+    ASSERT_NE(std::string::npos, out.find("\"name\":\"in\\\"ner\""));
+    ASSERT_NE(std::string::npos, out.find("\"cat\":\"turtle\""));
+    ASSERT_NE(std::string::npos, out.find("\"ph\":\"X\""));
+    ASSERT_EQ(']', out[out.find_last_not_of("\n")]);
+
+    std::remove(filename.c_str());
+}